@@ -0,0 +1,74 @@
+/* headless batch render of the jobs in the Batch section of a manifest, one PNG per job.
+ * Usage:
+ *   fractal_batch manifest.yaml [--small-pixels N]
+ * The manifest is read like config.yaml, JSON works too. Threads follow OMP_NUM_THREADS,
+ * the exit status is 1 if any job failed */
+
+#include <BatchRenderer.hpp>
+#include <ConfigLoader.hpp>
+#include <Profiler.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+int main(int argc, char **argv) {
+    std::string manifestPath;
+    long long smallPixels = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--small-pixels") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            smallPixels = std::atoll(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            manifestPath = arg;
+        }
+    }
+    if (manifestPath.empty()) {
+        std::cerr << "Usage: fractal_batch manifest.yaml [--small-pixels N]" << std::endl;
+        return 1;
+    }
+
+    try {
+        ConfigLoader manifest(manifestPath);
+        auto const &batch = manifest.batchParams;
+        std::size_t smallJobPixels =
+            smallPixels >= 0 ? static_cast<std::size_t>(smallPixels) : batch.smallJobPixels;
+        std::cerr << batch.jobs.size() << " jobs on " << omp_get_max_threads() << " threads"
+                  << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        BatchRenderer renderer(smallJobPixels);
+        std::vector<BatchRenderer::Result> results = renderer.render(batch.jobs, std::cerr);
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::size_t failed = 0;
+        double pixels = 0.0;
+        for (BatchRenderer::Result const &result : results) {
+            failed += result.error.empty() ? 0 : 1;
+            pixels += result.pixels;
+        }
+        std::cerr << results.size() - failed << " of " << results.size() << " jobs written in "
+                  << seconds << " s, " << results.size() / seconds << " jobs/s, "
+                  << pixels / seconds * 1e-6 << " Mpixels/s" << std::endl;
+        if (Profiler::enabled()) {
+            Profiler::report(std::cerr);
+        }
+        return failed ? 1 : 0;
+    } catch (std::exception const &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,439 @@
+/* headless benchmark: renders a fixed suite of viewports and writes the timings as JSON,
+ * so runs on different commits can be compared. Usage:
+ *   fractal_bench [--warmup N] [--repetitions N] [--filter substring] [--output file.json]
+ *                 [--trace trace.json] (only with FRACTAL_PROFILING)
+ *   fractal_bench --verify-thresholds
+ * the latter renders views either side of the Mandelbrot precision switch points in the
+ * precisions on both sides and fails if they change more pixels than a 1/100 pixel shift does */
+
+#include <ConfigLoader.hpp>
+#include <FractalFactory.hpp>
+#include <Mandelbrot.hpp>
+#include <Profiler.hpp>
+#include <SimdKernel.hpp>
+#include <Viewport.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+
+#ifndef FRACTAL_BUILD_TYPE
+#define FRACTAL_BUILD_TYPE "unknown"
+#endif
+
+namespace {
+
+struct Scenario {
+    std::string name;
+    sf::Vector2u size;
+    Viewport viewport;
+    std::optional<Viewport> previous; // rendered untimed first, for the reuse paths
+    ConfigLoader::FractalParams params{};
+};
+
+struct Result {
+    std::string name;
+    sf::Vector2u size;
+    std::vector<double> wallMs;
+    FrameStats stats;
+    // smooth iteration counts of the escaped pixels: the same for a view on every commit,
+    // whatever proves the inside or skips work
+    double escapedIterations = 0.0;
+    std::string fractal;
+    std::string precision;
+    // of the last repetition, only counted with FRACTAL_PROFILING
+    std::uint64_t iterations = 0; // z -> z^2 + c steps actually taken
+    std::uint64_t periodicExits = 0;
+    std::uint64_t proofIterations = 0;
+    std::uint64_t savedIterations = 0;
+};
+
+Viewport view(char const *centerX, char const *centerY, double width, sf::Vector2u size) {
+    return {HPReal(centerX), HPReal(centerY), width, width * size.y / size.x};
+}
+
+Viewport panned(Viewport vp, sf::Vector2u size, int pixelsX, int pixelsY) {
+    vp.centerX += pixelsX * (vp.width / size.x);
+    vp.centerY -= pixelsY * (vp.height / size.y);
+    return vp;
+}
+
+ConfigLoader::FractalParams fractal(char const *name, unsigned power = 3) {
+    ConfigLoader::FractalParams params;
+    params.name = name;
+    params.power = power;
+    return params;
+}
+
+ConfigLoader::FractalParams doubleDouble() {
+    ConfigLoader::FractalParams params;
+    params.doubleDoubleDeepZoom = true;
+    return params;
+}
+
+// past 1e-15 the pixels around the deep point escape after 7000 to 15000 iterations
+ConfigLoader::FractalParams deepest(bool doubleDoubleDeepZoom) {
+    ConfigLoader::FractalParams params;
+    params.maxIterations = 20000;
+    params.doubleDoubleDeepZoom = doubleDoubleDeepZoom;
+    return params;
+}
+
+Viewport zoomed(Viewport vp, double factor) {
+    vp.width /= factor;
+    vp.height /= factor;
+    return vp;
+}
+
+std::vector<Scenario> suite() {
+    const sf::Vector2u hd{1280, 720};
+    const sf::Vector2u small{640, 360};
+    const sf::Vector2u tiny{320, 180}; // double-double at 20000 iterations
+    const sf::Vector2u posterStrip{7016, 598}; // one a0 strip of the poster exporter
+    const char *deepX = "-0.743643887037158704752191506114774";
+    const char *deepY = "0.131825904205311970493132056385139";
+
+    Viewport seahorse = view("-0.745", "0.11", 0.05, hd);
+    return {
+        {"full_set", hd, view("-0.5", "0", 3.5, hd), {}},
+        {"seahorse_valley", hd, seahorse, {}},
+        {"interior_minibrot", hd, view("-1.7548776662", "0", 0.03, hd), {}},
+        {"period3_bulb", hd, view("-0.122", "0.745", 0.4, hd), {}},
+        {"deep_zoom_1e-9", small, view(deepX, deepY, 1e-9, small), {}},
+        {"deep_zoom_1e-12", small, view(deepX, deepY, 1e-12, small), {}},
+        {"deep_zoom_1e-12_double_double",
+         small,
+         view(deepX, deepY, 1e-12, small),
+         {},
+         doubleDouble()},
+        // below 1e-15 wide only perturbation and double-double resolve the pixels
+        {"deep_zoom_1e-16", small, view(deepX, deepY, 1e-16, small), {}, deepest(false)},
+        {"deep_zoom_1e-16_double_double",
+         tiny,
+         view(deepX, deepY, 1e-16, tiny),
+         {},
+         deepest(true)},
+        {"poster_strip", posterStrip, view("-0.745", "0.11", 0.05, posterStrip), {}},
+        {"seahorse_pan_64px", hd, panned(seahorse, hd, 64, 16), seahorse},
+        {"seahorse_zoom_2x", hd, zoomed(seahorse, 2.0), seahorse},
+        {"julia_default", hd, view("0", "0", 3.5, hd), {}, fractal("Julia")},
+        {"burning_ship_armada", hd, view("-1.762", "0.028", 0.08, hd), {}, fractal("BurningShip")},
+        {"tricorn_full", hd, view("-0.3", "0", 4.0, hd), {}, fractal("Tricorn")},
+        {"multibrot3_full", hd, view("0", "0", 3.0, hd), {}, fractal("Multibrot", 3)},
+        {"multibrot6_full", hd, view("0", "0", 3.0, hd), {}, fractal("Multibrot", 6)},
+    };
+}
+
+// interior pixels count nothing, what proving them costs differs between commits
+double escapedIterations(std::vector<float> const &field) {
+    double total = 0.0;
+    for (float n : field) {
+        total += std::max(n, 0.0f);
+    }
+    return total;
+}
+
+double timeMs(std::function<void()> const &func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+Result runScenario(Scenario const &scenario, int warmup, int repetitions) {
+    Result result{scenario.name, scenario.size, {}, {}, 0.0, scenario.params.name, ""};
+    for (int rep = -warmup; rep < repetitions; rep++) {
+        // a fresh fractal each time, nothing carries over but what the scenario sets up
+        sf::Image image(scenario.size);
+        Viewport vp = scenario.previous.value_or(scenario.viewport);
+        std::unique_ptr<EscapeTimeFractal> fractal = makeFractal(scenario.params, &image, &vp);
+        if (scenario.previous) {
+            fractal->compute();
+            vp = scenario.viewport;
+        }
+        std::uint64_t iterations = Profiler::total(Profiler::Counter::Iterations);
+        std::uint64_t exits = Profiler::total(Profiler::Counter::PeriodicExits);
+        std::uint64_t proof = Profiler::total(Profiler::Counter::ProofIterations);
+        std::uint64_t saved = Profiler::total(Profiler::Counter::SavedIterations);
+        double ms = timeMs([&] { fractal->compute(); });
+        if (rep >= 0) {
+            result.wallMs.push_back(ms);
+        }
+        result.iterations = Profiler::total(Profiler::Counter::Iterations) - iterations;
+        result.periodicExits = Profiler::total(Profiler::Counter::PeriodicExits) - exits;
+        result.proofIterations = Profiler::total(Profiler::Counter::ProofIterations) - proof;
+        result.savedIterations = Profiler::total(Profiler::Counter::SavedIterations) - saved;
+        result.stats = fractal->lastFrameStats();
+        result.precision = EscapeTimeFractal::precisionName(fractal->lastPrecision());
+        result.escapedIterations = escapedIterations(fractal->iterationField());
+    }
+    return result;
+}
+
+// computePoint alone, no frame machinery around it
+Result runComputePoint(int warmup, int repetitions) {
+    const sf::Vector2u size{1000, 1000};
+    Result result{"compute_point_seahorse", size, {}, {}, 0.0, "Mandelbrot", "double"};
+    sf::Image image(size);
+    Viewport vp = view("-0.745", "0.11", 0.05, size);
+    Mandelbrot mandelbrot(&image, &vp);
+
+    for (int rep = -warmup; rep < repetitions; rep++) {
+        double escaped = 0.0;
+        std::uint64_t iterations = Profiler::total(Profiler::Counter::Iterations);
+        double ms = timeMs([&] {
+            for (unsigned y = 0; y < size.y; y++) {
+                for (unsigned x = 0; x < size.x; x++) {
+                    double n = mandelbrot.computePoint(-0.77 + 0.05 * x / size.x,
+                                                       0.11 + 0.05 * (0.5 - double(y) / size.y));
+                    escaped += std::max(n, 0.0);
+                }
+            }
+        });
+        if (rep >= 0) {
+            result.wallMs.push_back(ms);
+        }
+        result.escapedIterations = escaped;
+        result.iterations = Profiler::total(Profiler::Counter::Iterations) - iterations;
+    }
+    result.stats.pixels = std::size_t(size.x) * size.y;
+    return result;
+}
+
+/* per pixel difference of two renders of a view, inside taken as the iteration limit: a
+ * pixel that flips inside is off as far as the palette goes */
+struct Difference {
+    double mean = 0.0;
+    double max = 0.0;
+    double changed = 0.0; // share of the pixels an iteration or more apart
+};
+
+Difference difference(std::vector<float> const &a, std::vector<float> const &b, int maxIterations) {
+    Difference d;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        double na = a[i] < 0.0f ? maxIterations : a[i];
+        double nb = b[i] < 0.0f ? maxIterations : b[i];
+        double delta = std::abs(na - nb);
+        d.mean += delta;
+        d.max = std::max(d.max, delta);
+        d.changed += delta >= 1.0 ? 1.0 : 0.0;
+    }
+    d.mean /= a.size();
+    d.changed /= a.size();
+    return d;
+}
+
+// iteration field of a fresh Mandelbrot with the default parameters, in the given precision
+std::vector<float> renderIn(EscapeTimeFractal::Precision precision,
+                            Viewport vp,
+                            sf::Vector2u size,
+                            int &maxIterations) {
+    sf::Image image(size);
+    std::unique_ptr<EscapeTimeFractal> fractal =
+        makeFractal(ConfigLoader::FractalParams{}, &image, &vp);
+    fractal->setPrecisionOverride(precision);
+    std::vector<float> field = fractal->computeRegion(vp, size.x, size.y, 0, 0, size.x, size.y);
+    maxIterations = fractal->getMaxIterations();
+    return field;
+}
+
+/* renders views at 1.25 and 0.8 times each switch point of Mandelbrot::choosePrecision() in
+ * double and in the precision the other side takes, and compares the share of changed pixels
+ * with that of the double image shifted by 1/100 pixel. False if any is larger. The mean is
+ * only reported, a single pixel flipping inside adds the whole budget to it */
+bool verifyThresholds() {
+    using Precision = EscapeTimeFractal::Precision;
+    const sf::Vector2u size{200, 150};
+    struct Center {
+        char const *name, *x, *y;
+    };
+    // boundary points accurate far below the smallest spacing checked
+    const Center centers[] = {
+        {"seahorse", "-0.743643887037158704752191506114774", "0.131825904205311970493132056385139"},
+        {"spiral", "-0.7746806106269039", "-0.1374168856037867"},
+        {"dendrite", "0.001643721971153", "-0.822467633298876"},
+        {"misiurewicz_i", "0", "1"},
+    };
+    struct SwitchPoint {
+        char const *name;
+        double spacing;
+        std::vector<Precision> precisions; // compared with double
+    };
+    const SwitchPoint switchPoints[] = {
+        {"float", Mandelbrot::FLOAT_THRESHOLD, {Precision::Float}},
+        {"perturbation",
+         Mandelbrot::PERTURBATION_THRESHOLD,
+         {Precision::Perturbation, Precision::DoubleDouble}},
+    };
+
+    bool within = true;
+    for (SwitchPoint const &point : switchPoints) {
+        for (double factor : {1.25, 0.8}) {
+            double spacing = point.spacing * factor;
+            for (Center const &center : centers) {
+                Viewport vp = view(center.x, center.y, spacing * size.x, size);
+                Viewport shifted = vp;
+                shifted.centerX += 0.01 * spacing;
+                int maxIterations = 0;
+                std::vector<float> reference = renderIn(Precision::Double, vp, size, maxIterations);
+                Difference bound = difference(
+                    renderIn(Precision::Double, shifted, size, maxIterations), reference,
+                    maxIterations);
+                for (Precision precision : point.precisions) {
+                    Difference d = difference(
+                        renderIn(precision, vp, size, maxIterations), reference, maxIterations);
+                    bool ok = d.changed <= bound.changed;
+                    within = within && ok;
+                    std::cout << point.name << " threshold x" << factor << ", " << center.name
+                              << ": " << EscapeTimeFractal::precisionName(precision)
+                              << " vs double mean " << d.mean << ", max " << d.max << ", "
+                              << 100.0 * d.changed << "% changed; 1/100 pixel shift mean "
+                              << bound.mean << ", max " << bound.max << ", "
+                              << 100.0 * bound.changed << "% changed "
+                              << (ok ? "ok" : "OVER") << std::endl;
+                }
+            }
+        }
+    }
+    return within;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    std::size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+void writeJson(std::ostream &out,
+               std::vector<Result> const &results,
+               int warmup,
+               int repetitions,
+               std::string const &isa) {
+    out << "{\n";
+    out << "  \"build_type\": \"" << FRACTAL_BUILD_TYPE << "\",\n";
+    out << "  \"isa\": \"" << isa << "\",\n";
+    out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+    out << "  \"warmup\": " << warmup << ",\n";
+    out << "  \"repetitions\": " << repetitions << ",\n";
+    out << "  \"scenarios\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        Result const &r = results[i];
+        double medianMs = median(r.wallMs);
+        double seconds = medianMs * 1e-3;
+        out << "    {\"name\": \"" << r.name << "\", \"width\": " << r.size.x
+            << ", \"height\": " << r.size.y << ", \"fractal\": \"" << r.fractal
+            << "\", \"precision\": \"" << r.precision << "\", \"pixels\": " << r.stats.pixels
+            << ", \"reused_pixels\": " << r.stats.reusedPixels << ", \"reuse_ratio\": "
+            << (r.stats.pixels ? double(r.stats.reusedPixels) / r.stats.pixels : 0.0)
+            << ", \"escaped_iterations\": " << r.escapedIterations
+            << ",\n     \"wall_ms\": {\"min\": "
+            << *std::min_element(r.wallMs.begin(), r.wallMs.end())
+            << ", \"median\": " << medianMs
+            << ", \"max\": " << *std::max_element(r.wallMs.begin(), r.wallMs.end())
+            << "}, \"pixels_per_s\": " << r.stats.pixels / seconds
+            << ", \"escaped_iterations_per_s\": " << r.escapedIterations / seconds;
+        if (Profiler::enabled()) {
+            out << ", \"iterations\": " << r.iterations
+                << ", \"iterations_per_s\": " << r.iterations / seconds
+                << ", \"periodic_exits\": " << r.periodicExits
+                << ", \"proof_iterations\": " << r.proofIterations
+                << ", \"saved_iterations\": " << r.savedIterations;
+        }
+        out << ", \"worker_utilization\": [";
+        for (std::size_t w = 0; w < r.stats.workerUtilization.size(); w++) {
+            out << (w ? ", " : "") << r.stats.workerUtilization[w];
+        }
+        out << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int warmup = 1;
+    int repetitions = 5;
+    std::string filter;
+    std::string output = "bench.json";
+    std::string trace;
+    bool verify = false;
+    // switches take no value, options the next argument
+    std::map<std::string, bool *> switches{{"--verify-thresholds", &verify}};
+    std::map<std::string, std::function<void(char const *)>> options{
+        {"--warmup", [&](char const *value) { warmup = std::atoi(value); }},
+        {"--repetitions", [&](char const *value) { repetitions = std::max(1, std::atoi(value)); }},
+        {"--filter", [&](char const *value) { filter = value; }},
+        {"--output", [&](char const *value) { output = value; }},
+        {"--trace", [&](char const *value) { trace = value; }},
+    };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (auto flag = switches.find(arg); flag != switches.end()) {
+            *flag->second = true;
+            continue;
+        }
+        auto option = options.find(arg);
+        if (option == options.end()) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        option->second(argv[++i]);
+    }
+
+    std::cout << "Escape-time kernel: " << SimdKernel::isaName(SimdKernel::detectIsa())
+              << std::endl;
+    if (verify) {
+        return verifyThresholds() ? 0 : 1;
+    }
+    std::vector<Result> results;
+    auto report = [&](Result const &r) {
+        std::cout << r.name << ": " << median(r.wallMs) << " ms median, reused "
+                  << r.stats.reusedPixels << "/" << r.stats.pixels;
+        if (Profiler::enabled()) {
+            std::cout << ", " << r.iterations << " iterations, " << r.periodicExits
+                      << " proven inside, saved "
+                      << r.savedIterations << " iterations for " << r.proofIterations;
+        }
+        std::cout << std::endl;
+        results.push_back(r);
+    };
+    for (Scenario const &scenario : suite()) {
+        if (scenario.name.find(filter) != std::string::npos) {
+            report(runScenario(scenario, warmup, repetitions));
+        }
+    }
+    if (std::string("compute_point_seahorse").find(filter) != std::string::npos) {
+        report(runComputePoint(warmup, repetitions));
+    }
+
+    std::ofstream file(output);
+    writeJson(file, results, warmup, repetitions, SimdKernel::isaName(SimdKernel::detectIsa()));
+    if (!file) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << output << std::endl;
+
+    if (Profiler::enabled()) {
+        Profiler::report(std::cout);
+        if (!trace.empty() && Profiler::writeChromeTrace(trace)) {
+            std::cout << "Trace written to " << trace << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/* renders a poster as tiles on fractal_worker processes and streams it into a PNG. Usage:
+ *   fractal_cluster [config.yaml] [--workers N] [--worker command]... [--size 7680x4320]
+ *                   [--center x y] [--view-width 4] [--output poster.png] [--verify]
+ *                   [--field poster.field]
+ * --workers starts N local workers (default one per core), every --worker command one more,
+ * e.g. --worker "ssh node2 /opt/fractal/fractal_worker". --verify renders the picture locally
+ * as well and fails unless the iteration fields are bit-identical. --field keeps the
+ * iteration field in a FieldFile: a new one is written as tiles arrive, an existing one is
+ * carried on with its own picture, fractal and colors in place of the options and config.
+ * A finished one is only colored into the PNG, no worker is started */
+
+#include <Colorizer.hpp>
+#include <ConfigLoader.hpp>
+#include <FieldFile.hpp>
+#include <FractalFactory.hpp>
+#include <PngStreamWriter.hpp>
+#include <RenderCluster.hpp>
+#include <Viewport.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// fractal_worker next to this executable, quoted for /bin/sh
+std::string localWorkerCommand() {
+    std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe");
+    std::string path = (exe.parent_path() / "fractal_worker").string();
+    std::string quoted = "'";
+    for (char c : path) {
+        quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string configPath = "config.yaml";
+    std::string output = "poster.png";
+    std::string fieldPath;
+    std::string centerX = "0", centerY = "0";
+    double viewWidth = 4.0;
+    unsigned width = 3840, height = 2160;
+    unsigned localWorkers = 0;
+    bool localWorkersGiven = false;
+    std::vector<std::string> remoteWorkers;
+    bool verify = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        int values = arg == "--center" ? 2
+                     : (arg == "--workers" || arg == "--worker" || arg == "--size" ||
+                        arg == "--view-width" || arg == "--output" || arg == "--field")
+                         ? 1
+                         : 0;
+        if (i + values >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+        if (arg == "--workers") {
+            localWorkers = static_cast<unsigned>(std::stoul(argv[++i]));
+            localWorkersGiven = true;
+        } else if (arg == "--worker") {
+            remoteWorkers.push_back(argv[++i]);
+        } else if (arg == "--size") {
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2 || !width || !height) {
+                std::cerr << "Size must look like 7680x4320" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--center") {
+            centerX = argv[++i];
+            centerY = argv[++i];
+        } else if (arg == "--view-width") {
+            viewWidth = std::stod(argv[++i]);
+        } else if (arg == "--output") {
+            output = argv[++i];
+        } else if (arg == "--field") {
+            fieldPath = argv[++i];
+        } else if (arg == "--verify") {
+            verify = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            configPath = arg;
+        }
+    }
+    if (!localWorkersGiven && remoteWorkers.empty()) {
+        localWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    try {
+        ConfigLoader config(configPath);
+        FieldHeader picture;
+        picture.fractal = config.fractalParams;
+        picture.viewport = {
+            HPReal(centerX), HPReal(centerY), viewWidth, viewWidth * height / width};
+        picture.width = width;
+        picture.height = height;
+        picture.tileSize = RenderCluster::TILE_SIZE;
+        std::unique_ptr<FieldFile> fieldFile;
+        if (!fieldPath.empty() && std::filesystem::exists(fieldPath)) {
+            fieldFile = std::make_unique<FieldFile>(fieldPath, true);
+            picture = fieldFile->header();
+            width = picture.width;
+            height = picture.height;
+            std::cerr << "Carrying on with " << fieldPath << ": " << fieldFile->tilesDone()
+                      << " of " << fieldFile->tileCount() << " tiles done" << std::endl;
+        }
+        // the workers iterate every pixel, so does the local render compared against
+        ConfigLoader::FractalParams params = picture.fractal;
+        params.subdivision = false;
+        params.tileCacheMB = 0;
+        params.iterationDeepening = false;
+        params.distanceSkipping = false;
+        params.distanceValidation = false;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> commands(localWorkers, localWorkerCommand());
+        commands.insert(commands.end(), remoteWorkers.begin(), remoteWorkers.end());
+        std::unique_ptr<RenderCluster> cluster;
+        if (!fieldFile || fieldFile->tilesDone() < fieldFile->tileCount()) {
+            cluster = std::make_unique<RenderCluster>(commands, params);
+        }
+
+        if (!fieldFile) {
+            // colors fixed by a low resolution pass over the whole poster, like PosterExporter
+            unsigned previewWidth = std::min(width, 1024u);
+            unsigned previewHeight =
+                std::max(1u, static_cast<unsigned>(double(height) * previewWidth / width));
+            std::vector<float> preview =
+                cluster->render(picture.viewport, previewWidth, previewHeight, std::cerr);
+            picture.colorRange = Colorizer::range(preview.data(), preview.size());
+            if (!fieldPath.empty()) {
+                fieldFile = std::make_unique<FieldFile>(fieldPath, picture);
+            }
+        }
+
+        Colorizer colorizer;
+        PngStreamWriter writer(output, width, height);
+        std::vector<std::uint8_t> rgba;
+        std::vector<float> field;
+        if (verify) {
+            field.resize(std::size_t(width) * height);
+        }
+        auto writeBand = [&](unsigned y0, unsigned rows, float const *band) {
+            std::size_t count = std::size_t(width) * rows;
+            rgba.resize(4 * count);
+            colorizer.apply(band, count, picture.colorRange, rgba.data());
+            writer.writeRows(rgba.data(), rows);
+            if (verify) {
+                std::copy(band, band + count, field.begin() + std::size_t(y0) * width);
+            }
+        };
+        if (cluster) {
+            cluster->render(picture.viewport, width, height, writeBand, std::cerr, fieldFile.get());
+        } else {
+            std::vector<float> band(std::size_t(width) * picture.tileSize);
+            for (unsigned y0 = 0; y0 < height; y0 += picture.tileSize) {
+                unsigned rows = std::min(picture.tileSize, height - y0);
+                fieldFile->readRows(y0, rows, band.data());
+                writeBand(y0, rows, band.data());
+            }
+        }
+        writer.finish();
+
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (cluster) {
+            ClusterStats stats = cluster->lastStats();
+            std::cerr << width << "x" << height << " in " << seconds << " s on "
+                      << cluster->liveWorkers() << " of " << commands.size()
+                      << " workers: " << stats.tiles << " tiles, " << stats.resumedTiles
+                      << " from the field file, " << stats.failedTiles << " retried, "
+                      << stats.duplicatedTiles << " duplicated, " << stats.lostWorkers
+                      << " workers lost, compressed to "
+                      << 100.0 * stats.compressedBytes / (4.0 * width * height) << " %"
+                      << std::endl;
+        } else {
+            std::cerr << width << "x" << height << " colored from " << fieldPath << " in "
+                      << seconds << " s" << std::endl;
+        }
+
+        if (verify) {
+            sf::Image image({width, height});
+            Viewport localVp = picture.viewport;
+            auto fractal = makeFractal(params, &image, &localVp);
+            fractal->compute();
+            std::vector<float> const &local = fractal->iterationField();
+            std::size_t mismatches = 0;
+            for (std::size_t i = 0; i < field.size(); i++) {
+                mismatches += std::memcmp(&field[i], &local[i], sizeof(float)) != 0;
+            }
+            std::cerr << "Verify: " << mismatches << " of " << field.size()
+                      << " pixels differ from the local render" << std::endl;
+            if (mismatches > 0) {
+                return 1;
+            }
+        }
+    } catch (std::exception const &e) {
+        std::cerr << "\n" << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+/* render worker of fractal_cluster: answers tile jobs on stdin with iteration fields on
+ * stdout until stdin closes. Not meant to be run by hand, the coordinator starts it, locally
+ * or over ssh. Messages go to stderr */
+
+#include <EscapeTimeFractal.hpp>
+#include <FractalFactory.hpp>
+#include <TileProtocol.hpp>
+#include <Viewport.hpp>
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+
+bool sameFractal(ConfigLoader::FractalParams const &a, ConfigLoader::FractalParams const &b) {
+    return a.name == b.name && a.power == b.power && a.juliaCr == b.juliaCr &&
+           a.juliaCi == b.juliaCi && a.doubleDoubleDeepZoom == b.doubleDoubleDeepZoom &&
+           a.distanceEstimation == b.distanceEstimation &&
+           a.maxIterations == b.maxIterations &&
+           a.iterationsPerZoomDecade == b.iterationsPerZoomDecade;
+}
+
+} // namespace
+
+int main() {
+    using namespace tileprotocol;
+
+    // stdout carries the protocol, what the fractal prints goes to stderr
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    // computeRegion() takes its frame from the job, the image is never drawn into
+    sf::Image image({1, 1});
+    Viewport viewport{0, 0, 4.0, 4.0};
+    std::unique_ptr<EscapeTimeFractal> fractal;
+    ConfigLoader::FractalParams params;
+
+    try {
+        Message message;
+        while (readMessage(STDIN_FILENO, message)) {
+            if (message.type != MessageType::Job) {
+                std::cerr << "Worker: unexpected message" << std::endl;
+                return 1;
+            }
+            Job job = decodeJob(message.payload);
+            Result result;
+            result.id = job.id;
+            std::string error;
+            try {
+                // kept across jobs, so is the reference orbit of a deep frame
+                if (!fractal || !sameFractal(params, job.fractal)) {
+                    fractal.reset();
+                    params = job.fractal;
+                    fractal = makeFractal(params, &image, &viewport);
+                }
+                result.field = fractal->computeRegion(
+                    job.viewport, job.width, job.height, job.x0, job.y0, job.x1, job.y1);
+            } catch (std::exception const &e) {
+                error = e.what();
+            }
+            if (error.empty()) {
+                writeMessage(STDOUT_FILENO, MessageType::Result, encodeResult(result));
+            } else {
+                writeMessage(STDOUT_FILENO, MessageType::Error, encodeError(job.id, error));
+            }
+        }
+    } catch (std::exception const &e) {
+        std::cerr << "Worker: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
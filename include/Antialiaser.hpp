@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Colorizer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct AntialiasParams {
+    unsigned maxSamples = 0; // per pixel, 4, 16 or 64, 0 disables
+    double budget = 0.5;     // extra samples per pixel of the frame on average
+    double tolerance = 0.004; // standard error of a pixel's mean color to stop at, linear 0-1
+};
+
+/* what the last resolve() did */
+struct AntialiasStats {
+    std::size_t edgePixels = 0; // flagged, whether the budget reached them or not
+    std::size_t pixels = 0;     // supersampled
+    std::size_t samples = 0;    // extra samples iterated
+};
+
+/* adaptive supersampling of the edges of a frame. Pixels on the inside/outside boundary or
+ * whose color jumps against a neighbour get stratified, jittered samples in rounds, until
+ * the standard error of their mean color falls below the tolerance, they hit maxSamples or
+ * the frame its budget. Smooth regions, most of a frame, keep their single sample */
+class Antialiaser {
+public:
+    /* iterates count points at fractional pixel positions, pixel (x, y) at (x, y) */
+    using Sampler = std::function<
+        void(double const *px, double const *py, std::size_t count, double *values)>;
+
+    Antialiaser(AntialiasParams params, std::size_t width, std::size_t height);
+
+    /* rgba holds the colors of the one-sample field and gets the resolved ones, sampler is
+     * called concurrently */
+    AntialiasStats resolve(std::vector<float> const &field,
+                           std::uint8_t *rgba,
+                           Colorizer &colorizer,
+                           ColorRange range,
+                           Sampler const &sampler);
+
+private:
+    struct Pixel {
+        std::size_t idx;
+        double sum[3];
+        double sumSquares[3];
+        unsigned samples; // the one of the base pass included
+        double priority;  // edge contrast, then standard error
+    };
+
+    std::vector<Pixel> findEdges(std::vector<float> const &field, std::uint8_t const *rgba) const;
+    double standardError(Pixel const &pixel) const;
+
+    AntialiasParams params;
+    std::size_t width, height;
+    unsigned side; // strata per row of a pixel, side * side = maxSamples
+    /* stratum of the i-th sample, bit reversed Morton order: every 4 in a row cover the
+     * quadrants, every 16 the sixteenths */
+    std::vector<unsigned> strata;
+
+    /* largest channel difference in sRGB bytes that still counts as smooth */
+    static constexpr int EDGE_CONTRAST = 12;
+    static constexpr unsigned SAMPLES_PER_ROUND = 4;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <FractalBase.hpp>
+#include <QualityController.hpp>
+#include <Viewport.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* runs FractalBase::compute() on a background thread so the ui thread only submits viewports
+ * and uploads whatever frame is ready. A new request cancels the frame in flight,
+ * coarse passes are published as they finish */
+class AsyncRenderer {
+public:
+    AsyncRenderer(FractalBase &fractal, sf::Image *renderImage, QualityParams quality = {});
+    ~AsyncRenderer();
+
+    /* full quality */
+    void request(Viewport const &viewport);
+
+    /* while the view moves: resolution and iterations lowered as far as it takes to stay in
+     * the frame budget, the frame is published upscaled */
+    void requestInteractive(Viewport const &viewport);
+
+    /* once input stopped: renders the last interactive frame again at rising quality up to
+     * full, nothing if it already was */
+    void refine();
+
+    /* frame times measured so far and the level the last interactive frame got */
+    QualityController qualityController() const;
+    QualityLevel lastInteractiveLevel() const;
+
+    /* copies the latest published frame into the texture, false if nothing new. After pans
+     * only the exposed bands go up: the texture is a ring, repeated, and the sprite's texture
+     * rect starts at its origin */
+    bool uploadIfReady(sf::Texture &texture, sf::Sprite &sprite);
+
+    /* runs change on the render thread, then recolors the shown frame without iterating it
+     * again. A frame in flight is not cancelled, the recolor follows it */
+    void requestRecolor(std::function<void(FractalBase &)> change);
+
+    /* runs change on the render thread, then renders the last requested view again at full
+     * quality. For changes to what a pixel iterates to, like the iteration limit */
+    void requestChange(std::function<void(FractalBase &)> change);
+
+    /* cancels and holds the render thread while func uses the fractal directly */
+    void runExclusive(std::function<void()> const &func);
+
+private:
+    void renderLoop();
+    /* renders renderVp at level into its image, published unless cancelled */
+    void renderLevel(QualityLevel level, bool progressive);
+    /* update is what changed since the frame the front image shows, null for everything */
+    void publish(ImageUpdate const *update = nullptr);
+    /* the rect of the front image at its place in the texture ring, in up to 4 pieces */
+    void uploadRect(sf::Texture &texture, sf::IntRect rect);
+    /* submits viewport to be rendered at every level in turn */
+    void submit(Viewport const &viewport, std::vector<QualityLevel> levels);
+
+    FractalBase &fractal;
+    sf::Image *renderImage; // only touched by the thread holding computeMutex
+    sf::Image scaledImage;  // frames below full resolution
+    sf::Image *shownImage;  // what the last frame went into, the one recolored
+    double shownScale = 1.0;
+    Viewport renderVp{};    // requested
+    Viewport frameVp{};     // rendered, widened to whole pixels for a scaled frame
+    std::vector<std::uint8_t> upscaled;
+
+    mutable std::mutex requestMutex;
+    std::condition_variable requestCv;
+    Viewport pendingVp{};
+    std::vector<QualityLevel> pendingLevels;
+    Viewport lastRequestedVp{};
+    bool hasPending = false;
+    QualityController quality; // under requestMutex
+    QualityLevel interactiveLevel;
+    std::vector<std::function<void(FractalBase &)>> pendingChanges;
+    bool stopping = false;
+
+    std::mutex computeMutex;
+
+    bool frontIsLastFrame = false; // the front image is the fractal's last complete frame
+
+    std::mutex frameMutex;
+    sf::Image frontImage;
+    bool frameReady = false;
+    /* what the texture lacks of the front image, moves and rects add up until an upload */
+    bool uploadFull = true;
+    sf::Vector2i uploadShift{};
+    std::vector<sf::IntRect> uploadRects;
+    sf::Vector2i textureOrigin{}; // texel of pixel (0, 0), ui thread only
+    std::vector<std::uint8_t> uploadBuffer;
+
+    /* pending rects beyond this are not worth tracking, the whole frame goes up */
+    static constexpr std::size_t MAX_UPLOAD_RECTS = 16;
+
+    std::thread worker;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <ConfigLoader.hpp>
+#include <EscapeTimeFractal.hpp>
+#include <Viewport.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* renders the jobs of a batch manifest into PNGs in one process, headless. Jobs up to
+ * smallJobPixels run side by side, one per OpenMP thread with a single threaded compute(),
+ * so short jobs keep every core busy; bigger ones run one after the other on all threads.
+ * Every thread keeps its fractal, image and buffers from job to job and only builds a new
+ * fractal when a job's formula or options differ. Each image equals a fresh render of its job */
+class BatchRenderer {
+public:
+    struct Result {
+        std::size_t pixels = 0;
+        double milliseconds = 0.0;
+        std::string error; // empty if the PNG was written
+    };
+
+    explicit BatchRenderer(std::size_t smallJobPixels);
+
+    /* one result per job, in order. A failing job is reported in its result and the others
+     * go on. Failures go to log as they happen */
+    std::vector<Result> render(std::vector<ConfigLoader::BatchParams::Job> const &jobs,
+                               std::ostream &log);
+
+private:
+    /* what one thread reuses across its jobs */
+    struct Slot {
+        sf::Image image;
+        Viewport viewport{};
+        std::unique_ptr<EscapeTimeFractal> fractal;
+        ConfigLoader::FractalParams params; // the fractal was made from
+    };
+
+    Result renderJob(Slot &slot, ConfigLoader::BatchParams::Job const &job);
+    /* the slot's fractal if it iterates the same formula with the same options, else a new one */
+    static EscapeTimeFractal &fractalFor(Slot &slot, ConfigLoader::FractalParams const &params);
+
+    std::size_t smallJobPixels;
+    std::vector<Slot> slots; // one per OpenMP thread
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <FractalBase.hpp>
+#include <Viewport.hpp>
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+struct DensityParams {
+    /* iteration limit per channel: one is a Buddhabrot in the palette, three a Nebulabrot in
+     * red, green and blue */
+    std::vector<int> limits{2000};
+    std::uint64_t samplesPerPass = std::uint64_t(1) << 20;
+    std::uint64_t targetSamples = std::uint64_t(1) << 26; // compute() stops there
+    double importance = 0.5;     // share of the samples drawn from the importance map
+    std::string checkpointPath;  // empty for none
+    double checkpointSeconds = 30.0;
+};
+
+/* density fractal: random c whose orbit escapes within a channel's limit add every point of
+ * the orbit to that channel's histogram. compute() adds passes of samples until
+ * targetSamples, the image and the progress callback follow every pass, and goes on where it
+ * stopped while the frame stays the same. Threads fill histograms of their own, merged after
+ * every pass. Points inside the cardioid or period 2 bulb and orbits the periodicity check
+ * catches are rejected before anything is plotted. c is drawn from a grid of cells over
+ * |c| < 2, weighted towards the long orbits near the boundary and the cells whose orbits
+ * hit the view, every sample weighted back so the estimate stays unbiased */
+class Buddhabrot final : public FractalBase {
+public:
+    Buddhabrot(sf::Image *image, Viewport *vp, DensityParams params);
+
+    void compute() override;
+
+    /* escape time of c for the largest limit as in escapeTime(), -1 if it does not escape */
+    double computePoint(double x, double y) const override;
+
+    /* samples added to the histograms of the current frame */
+    std::uint64_t samples() const { return totalSamples; }
+
+private:
+    /* where the histograms are, any change starts them over */
+    struct Frame {
+        unsigned width = 0, height = 0;
+        double left = 0.0, top = 0.0;
+        double dx = 0.0, dy = 0.0;
+        bool operator==(Frame const &other) const;
+    };
+
+    struct ThreadState {
+        std::mt19937_64 rng;
+        std::vector<float> histogram; // pixel major, channels interleaved
+        std::vector<double> cellHits, cellSamples;
+        std::vector<double> zr, zi; // orbit of the sample
+    };
+
+    /* iterates c recording its orbit, escape count for the largest limit or -1 */
+    int orbit(double cr, double ci, ThreadState &thread) const;
+    void runPass(std::uint64_t samples);
+    void buildPrior();
+    /* per cell probability of the next pass, uniform share included */
+    void updateSampling();
+    void show();
+
+    bool loadCheckpoint();
+    void saveCheckpoint() const;
+
+    DensityParams params;
+    int maxLimit;
+    std::size_t channels;
+
+    Frame frame;
+    bool frameValid = false;
+    std::vector<double> histogram; // of all passes, pixel major, channels interleaved
+    std::uint64_t totalSamples = 0;
+    std::vector<ThreadState> threads;
+
+    /* the sampling grid over [-2, 2]^2 */
+    std::vector<double> prior;     // mean escape count of a few points per cell
+    std::vector<double> cellHits;  // plotted points in the frame from the cell's samples
+    std::vector<double> cellSamples;
+    std::vector<double> cellProbability;
+    std::vector<double> cellCdf;   // of the importance share
+    std::vector<float> field;      // shown density, palette mode
+
+    static constexpr int GRID = 256;
+    static constexpr double SPAN = 4.0; // of the grid, centered on 0
+    static constexpr std::uint64_t CANCEL_CHECK_SAMPLES = 4096;
+    /* channels are scaled to this quantile of their nonzero pixels */
+    static constexpr double WHITE_QUANTILE = 0.999;
+};
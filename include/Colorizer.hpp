@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* iteration counts mapped onto the ends of the palette */
+struct ColorRange {
+    double minIter = 0.0;
+    double maxIter = 0.0;
+};
+
+/* turns an iteration field into RGBA pixels through a lookup table, so changing the palette
+ * or the range only costs one pass over the field, never any iterating */
+class Colorizer {
+public:
+    Colorizer();
+
+    void setPalette(std::vector<sf::Color> palette);
+
+    /* palettes to cycle through, index taken modulo their count */
+    static std::vector<sf::Color> preset(std::size_t index);
+
+    /* range of the escaped points, interior (-1) and unknown (NaN) points left out */
+    static ColorRange range(float const *field, std::size_t count);
+
+    /* pixels hold 4 bytes per field value */
+    void apply(float const *field, std::size_t count, ColorRange range, std::uint8_t *pixels);
+
+private:
+    void buildLevels(ColorRange range);
+    std::uint32_t paletteColor(double t) const;
+
+    std::vector<sf::Color> palette;
+
+    /* colors of COLOR_LEVELS evenly spaced iteration counts across the range, log scaled */
+    static constexpr std::size_t COLOR_LEVELS = std::size_t(1) << 16;
+    std::vector<std::uint32_t> levels;
+    ColorRange levelsRange{-1.0, -1.0};
+    bool levelsValid = false;
+};
@@ -1,17 +1,94 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class ConfigLoader {
 public:
     ConfigLoader(std::string const& filename);
     
     struct WindowParams {
-        unsigned width;
-        unsigned height;
+        unsigned width = 800;
+        unsigned height = 566;
     } windowParams;
 
     struct FractalParams {
-        std::string name;
+        std::string name = "Mandelbrot"; // or Julia, BurningShip, Tricorn, Multibrot, Buddhabrot,
+                                         // Nebulabrot
+        unsigned power = 3;              // Multibrot only
+        double juliaCr = -0.8;           // Julia only
+        double juliaCi = 0.156;
+        bool subdivision = false;
+        bool subdivisionGuard = false;
+        bool doubleDoubleDeepZoom = false;
+        int maxIterations = 2000;        // at the initial 4 wide view
+        int iterationsPerZoomDecade = 0; // added for every tenfold zoom
+        bool iterationDeepening = false;
+        bool distanceEstimation = false; // Mandelbrot only
+        bool distanceSkipping = true;
+        bool distanceValidation = false;
+        unsigned tileCacheMB = 0; // 0 disables the tile cache
+        std::string tileSpillDirectory;
+        unsigned tileSpillMB = 1024;
     } fractalParams;
-};
\ No newline at end of file
+
+    /* frames of the viewer while the view moves, lowered in quality to stay in the budget */
+    struct InteractionParams {
+        double frameBudgetMs = 16.0;
+        double minScale = 0.125;          // of the window's resolution
+        double minIterationScale = 0.125; // of the iteration limit
+    } interactionParams;
+
+    /* posters saved from the viewer, edge pixels supersampled */
+    struct PosterParams {
+        unsigned antialiasSamples = 16; // per pixel at most, 4, 16 or 64, 0 disables
+        double antialiasBudget = 0.5;   // extra samples per poster pixel on average
+        double antialiasTolerance = 0.004;
+    } posterParams;
+
+    /* Buddhabrot and Nebulabrot, a Buddhabrot's limit is MaxIterations */
+    struct DensityParams {
+        std::uint64_t samplesPerPass = std::uint64_t(1) << 20;
+        std::uint64_t targetSamples = std::uint64_t(1) << 26;
+        double importance = 0.5;
+        std::string checkpoint; // empty for none
+        double checkpointSeconds = 30.0;
+        std::vector<int> nebulabrotLimits{5000, 500, 50}; // red, green, blue
+    } densityParams;
+
+    /* fractal_video only, keyframe centers stay strings so they keep their full precision */
+    struct VideoParams {
+        struct Keyframe {
+            double time = 0.0; // seconds
+            std::string centerX = "0";
+            std::string centerY = "0";
+            double logZoom = 0.0; // log2 of the zoom, the viewer's initial view is 0
+        };
+        unsigned width = 1280;
+        unsigned height = 720;
+        double fps = 30.0;
+        std::string mode = "octave"; // or exact
+        std::string output = "zoom.y4m";
+        std::vector<Keyframe> keyframes;
+    } videoParams;
+
+    /* fractal_batch only, every job is its Fractal keys over the Fractal section. Centers
+     * stay strings so they keep their full precision */
+    struct BatchParams {
+        struct Job {
+            std::string output; // PNG file
+            unsigned width = 256;
+            unsigned height = 256;
+            std::string centerX = "-0.5";
+            std::string centerY = "0";
+            double viewWidth = 4.0; // of the real axis, the height follows the aspect
+            FractalParams fractal;
+        };
+        std::size_t smallJobPixels = std::size_t(1) << 18; // up to there one thread per job
+        unsigned width = 256; // of jobs without a size
+        unsigned height = 256;
+        std::vector<Job> jobs;
+    } batchParams;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Precision.hpp>
+
+/* unevaluated sum hi + lo of two doubles, about 106 bits of mantissa. Only the operations
+ * the escape-time loop needs, exact error terms by Knuth's two-sum and Dekker's product.
+ * Needs strict IEEE evaluation: no fused multiply-add contraction, no -ffast-math */
+struct DoubleDouble {
+    double hi = 0.0;
+    double lo = 0.0;
+
+    DoubleDouble() = default;
+    DoubleDouble(double x) : hi(x) {}
+    DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+    explicit operator double() const { return hi + lo; }
+};
+
+namespace doubledouble {
+
+inline DoubleDouble twoSum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    double err = (a - (s - bb)) + (b - bb);
+    return {s, err};
+}
+
+inline DoubleDouble quickTwoSum(double a, double b) {
+    double s = a + b;
+    return {s, b - (s - a)};
+}
+
+inline DoubleDouble twoProduct(double a, double b) {
+    constexpr double SPLITTER = 134217729.0; // 2^27 + 1
+    double p = a * b;
+    double ta = SPLITTER * a, tb = SPLITTER * b;
+    double aHi = ta - (ta - a), bHi = tb - (tb - b);
+    double aLo = a - aHi, bLo = b - bHi;
+    double err = ((aHi * bHi - p) + aHi * bLo + aLo * bHi) + aLo * bLo;
+    return {p, err};
+}
+
+} // namespace doubledouble
+
+inline DoubleDouble operator+(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble s = doubledouble::twoSum(a.hi, b.hi);
+    DoubleDouble t = doubledouble::twoSum(a.lo, b.lo);
+    s = doubledouble::quickTwoSum(s.hi, s.lo + t.hi);
+    return doubledouble::quickTwoSum(s.hi, s.lo + t.lo);
+}
+
+inline DoubleDouble operator-(DoubleDouble a) { return {-a.hi, -a.lo}; }
+
+inline DoubleDouble operator-(DoubleDouble a, DoubleDouble b) { return a + (-b); }
+
+inline DoubleDouble operator*(DoubleDouble a, DoubleDouble b) {
+    DoubleDouble p = doubledouble::twoProduct(a.hi, b.hi);
+    return doubledouble::quickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+inline bool operator<(DoubleDouble a, DoubleDouble b) {
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline bool operator<=(DoubleDouble a, DoubleDouble b) { return !(b < a); }
+
+template <> struct PrecisionTraits<DoubleDouble> {
+    static constexpr double PERIOD_TOLERANCE = 1e-40;
+    static constexpr double CYCLE_TOLERANCE = 1e-30;
+    static constexpr double NEWTON_TOLERANCE = 1e-56;
+    static constexpr double DERIVATIVE_FLOOR = 1e-100;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+/* the Mandelbrot kernels save z for the cycle check at n = 1, 2, 4, ... (Brent), the first
+ * save and the first gap to the next one */
+constexpr int FIRST_CYCLE_CHECK = 1;
+
+/* where the escape-time loop of a point stopped at the iteration limit, so it can go on from
+ * there once the limit rises and end exactly where a run from z = 0 would. Data only so the
+ * per-isa translation units can include it */
+struct EscapeState {
+    double zr = 0.0, zi = 0.0;         // z, or the delta from the reference orbit when perturbing
+    double zrOld = 0.0, ziOld = 0.0;   // z at the last periodicity check
+    int n = 0;                         // iterations done, 0 starts over
+    int nextCheck = FIRST_CYCLE_CHECK; // periodicity check schedule
+    int checkPeriod = FIRST_CYCLE_CHECK;
+    int m = 0;                         // reference orbit index, perturbation only
+    bool capped = false;               // set when the point stopped at the limit, not proven inside
+    double dz2 = 1.0;                  // |dz / d saved z|^2, cycle check of the Mandelbrot kernels
+};
+
+/* the Mandelbrot kernels try a cycle of period p with Newton only while p * CYCLE_PROOF_COST
+ * is below the iterations left: the scalar proof takes a few passes over the cycle, each
+ * iteration worth several lanes of the vector loop */
+constexpr int CYCLE_PROOF_COST = 32;
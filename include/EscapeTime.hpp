@@ -0,0 +1,255 @@
+#pragma once
+
+#include <EscapeState.hpp>
+#include <Precision.hpp>
+#include <Profiler.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/* building blocks of the Mandelbrot escape-time loop shared by the scalar and SIMD kernels,
+ * templated on the scalar type: float, double or DoubleDouble. Any change here has to be
+ * mirrored in SimdKernelImpl.hpp to keep both bit-identical */
+
+template <typename T> bool isInCardioidOrBulb(T cr, T ci) {
+    T crShifted = cr - T(0.25);
+    T q = crShifted * crShifted + ci * ci;
+    if (q * (q + crShifted) < T(0.25) * ci * ci) {
+        return true;
+    }
+    T crPlus1 = cr + T(1.0);
+    return crPlus1 * crPlus1 + ci * ci < T(0.0625);
+}
+
+inline double smoothIterationCount(int n, double modulus2) {
+    double log_zn = std::log(modulus2) / 2.0;
+    double nu = std::log(log_zn / std::log(2.0)) / std::log(2.0);
+    return n + 1.0 - nu;
+}
+
+/* whether c has an attracting cycle of the given period through about z, which proves it
+ * inside. Newton on f^period(w) = w from w = z, with the derivative of f^period carried along
+ * in double: once the step is down to NEWTON_TOLERANCE w is on the cycle and that derivative
+ * its multiplier, below 1 in modulus the cycle attracts. Adds the iterations it took to cost */
+constexpr int CYCLE_NEWTON_STEPS = 8;
+
+template <typename T> bool attractingCycle(T cr, T ci, T zr, T zi, int period, std::uint64_t &cost) {
+    if (period <= 0) {
+        return false;
+    }
+    T wr = zr, wi = zi;
+    for (int step = 0; step < CYCLE_NEWTON_STEPS; step++) {
+        T fr = wr, fi = wi;
+        double dr = 1.0, di = 0.0;
+        for (int k = 0; k < period; k++) {
+            T fr2 = fr * fr, fi2 = fi * fi;
+            if (T(4.0) < fr2 + fi2) {
+                cost += k;
+                return false;
+            }
+            double r = static_cast<double>(fr), i = static_cast<double>(fi);
+            double nextDr = 2.0 * (r * dr - i * di);
+            di = 2.0 * (r * di + i * dr);
+            dr = nextDr;
+            fi = T(2.0) * fr * fi + ci;
+            fr = fr2 - fi2 + cr;
+        }
+        cost += period;
+        // a cycle that attracts contracts near it too, the period of a neighbour may not
+        if (step == 0 && !(dr * dr + di * di < 1.0)) {
+            return false;
+        }
+        // w - (f^period(w) - w) / (d - 1)
+        double gr = static_cast<double>(fr - wr), gi = static_cast<double>(fi - wi);
+        double er = dr - 1.0, ei = di;
+        double denominator = er * er + ei * ei;
+        if (!(denominator > 0.0)) {
+            return false;
+        }
+        double stepR = (gr * er + gi * ei) / denominator;
+        double stepI = (gi * er - gr * ei) / denominator;
+        if (stepR * stepR + stepI * stepI < PrecisionTraits<T>::NEWTON_TOLERANCE) {
+            return dr * dr + di * di < 1.0;
+        }
+        wr = wr - T(stepR);
+        wi = wi - T(stepI);
+    }
+    return false;
+}
+
+/* the first save of the cycle check at which the period of the point before is tried, 0 for
+ * none. Late enough for the orbit to have come near the cycle */
+inline int hintCheckAt(int hint) {
+    if (hint <= 0) {
+        return 0;
+    }
+    int at = 1;
+    while (at < 2 * hint) {
+        at *= 2;
+    }
+    return at;
+}
+
+/* returns iteration count, or -1 if inside set. With a state the point starts from it unless
+ * its n is 0, and a point that stops at the limit leaves its state there, marked capped.
+ * Inside is proven by an attracting cycle: z is saved at n = 1, 2, 4, ... (Brent) and the
+ * derivative of z by the saved z tracked in modulus. Once z comes back near the saved one
+ * where that contracts, the distance in iterations is tried as a period, once per save, if
+ * that pays; an orbit that closes up to PERIOD_TOLERANCE on its own needs no proof.
+ * With a period and no state the point also tries the period given, the one of the pixel
+ * before, and leaves there the period it was proven inside with, 0 if it was not */
+template <typename T>
+double escapeTime(T cr, T ci, int maxIterations, EscapeState *state = nullptr, int *period = nullptr) {
+    T zr = T(0.0), zi = T(0.0);
+    T zrOld = T(0.0), ziOld = T(0.0);
+    T dz2 = T(1.0);
+    int checkPeriod = FIRST_CYCLE_CHECK;
+    int nextCheck = checkPeriod;
+    int n = 0;
+    int hint = period && !state ? *period : 0;
+    int hintCheck = hintCheckAt(hint);
+    if (period) {
+        *period = 0;
+    }
+    if (state && state->n > 0) {
+        zr = T(state->zr), zi = T(state->zi);
+        zrOld = T(state->zrOld), ziOld = T(state->ziOld);
+        dz2 = T(state->dz2);
+        checkPeriod = state->checkPeriod;
+        nextCheck = state->nextCheck;
+        n = state->n;
+    } else if (isInCardioidOrBulb(cr, ci)) {
+        PROFILE_COUNT(BulbSkips, 1);
+        return -1;
+    }
+    T zr2 = zr * zr, zi2 = zi * zi;
+    int start = n;
+    std::uint64_t cost = 0;
+    while (zr2 + zi2 <= T(4.0) && n < maxIterations) {
+        // |f'(z)|^2 = 4 |z|^2 of z before the step
+        dz2 = dz2 * (T(4.0) * (zr2 + zi2));
+        if (!(T(PrecisionTraits<T>::DERIVATIVE_FLOOR) < dz2)) {
+            dz2 = T(PrecisionTraits<T>::DERIVATIVE_FLOOR);
+        }
+        zi = T(2.0) * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        ++n;
+        int proven = 0;
+        if (n == nextCheck) {
+            if (n == hintCheck && hint * CYCLE_PROOF_COST < maxIterations - n &&
+                attractingCycle(cr, ci, zr, zi, hint, cost)) {
+                proven = hint;
+                PROFILE_COUNT(HintedExits, 1);
+            }
+            zrOld = zr;
+            ziOld = zi;
+            dz2 = T(1.0);
+            nextCheck += checkPeriod;
+            checkPeriod *= 2;
+        } else if (dz2 < T(1.0)) {
+            T diffR = zr - zrOld;
+            T diffI = zi - ziOld;
+            T distance2 = diffR * diffR + diffI * diffI;
+            if (distance2 < T(PrecisionTraits<T>::CYCLE_TOLERANCE)) {
+                // closed up on its own as far as Newton would get it, or proven
+                int candidate = n - (nextCheck - checkPeriod / 2);
+                if (distance2 < T(PrecisionTraits<T>::PERIOD_TOLERANCE) ||
+                    (candidate * CYCLE_PROOF_COST < maxIterations - n &&
+                     attractingCycle(cr, ci, zr, zi, candidate, cost))) {
+                    proven = candidate;
+                } else {
+                    // not again before the next save
+                    zrOld = ziOld = T(std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+        }
+        if (proven) {
+            if (period) {
+                *period = proven;
+            }
+            PROFILE_COUNT(PeriodicExits, 1);
+            PROFILE_COUNT(Iterations, n - start);
+            PROFILE_COUNT(ProofIterations, cost);
+            PROFILE_COUNT(SavedIterations, maxIterations - n);
+            return -1;
+        }
+    }
+    PROFILE_COUNT(Iterations, n - start);
+    PROFILE_COUNT(ProofIterations, cost);
+    if (n == maxIterations) {
+        if (state) {
+            *state = {static_cast<double>(zr),
+                      static_cast<double>(zi),
+                      static_cast<double>(zrOld),
+                      static_cast<double>(ziOld),
+                      n,
+                      nextCheck,
+                      checkPeriod,
+                      0,
+                      true,
+                      static_cast<double>(dz2)};
+        }
+        return -1;
+    } else {
+        return smoothIterationCount(n, static_cast<double>(zr2 + zi2));
+    }
+}
+
+/* exterior distance estimate 2 |z| ln|z| / |dz/dc| of c, in units of c, or -1 if inside. The
+ * set is at least a quarter of it away (Koebe) and at most all of it, sound for escape radii
+ * well past 2 so the loop runs on to DISTANCE_ESCAPE_RADIUS2. A point that stops at the limit
+ * marks the state capped but leaves its n 0, it starts over at a higher one */
+constexpr double DISTANCE_ESCAPE_RADIUS2 = 1e6;
+
+template <typename T>
+double distanceEstimate(T cr, T ci, int maxIterations, EscapeState *state = nullptr) {
+    if (isInCardioidOrBulb(cr, ci)) {
+        PROFILE_COUNT(BulbSkips, 1);
+        return -1;
+    }
+    T zr = T(0.0), zi = T(0.0);
+    T zrOld = T(0.0), ziOld = T(0.0);
+    T zr2 = T(0.0), zi2 = T(0.0);
+    double dzr = 0.0, dzi = 0.0;
+    int checkPeriod = 20;
+    int nextCheck = checkPeriod;
+    int n = 0;
+    while (zr2 + zi2 <= T(DISTANCE_ESCAPE_RADIUS2) && n < maxIterations) {
+        // dz' = 2 z dz + 1 before z moves on
+        double r = static_cast<double>(zr), i = static_cast<double>(zi);
+        double nextDzr = 2.0 * (r * dzr - i * dzi) + 1.0;
+        dzi = 2.0 * (r * dzi + i * dzr);
+        dzr = nextDzr;
+        zi = T(2.0) * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        ++n;
+        if (n == nextCheck) {
+            T diffR = zr - zrOld;
+            T diffI = zi - ziOld;
+            if (diffR * diffR + diffI * diffI < T(PrecisionTraits<T>::PERIOD_TOLERANCE)) {
+                PROFILE_COUNT(PeriodicExits, 1);
+                PROFILE_COUNT(Iterations, n);
+                return -1;
+            }
+            zrOld = zr;
+            ziOld = zi;
+            nextCheck += checkPeriod;
+            checkPeriod *= 2;
+        }
+    }
+    PROFILE_COUNT(Iterations, n);
+    if (n == maxIterations) {
+        if (state) {
+            *state = EscapeState{};
+            state->capped = true;
+        }
+        return -1;
+    }
+    double modulus = std::sqrt(static_cast<double>(zr2 + zi2));
+    return 2.0 * modulus * std::log(modulus) / std::hypot(dzr, dzi);
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <EscapeState.hpp>
+#include <FractalBase.hpp>
+#include <TileCache.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* frame machinery shared by every escape-time fractal: progressive passes, reuse of the
+ * previous frame, tile cache, tile scheduler, subdivision. Subclasses only iterate pixels,
+ * computePixels() is called once per scheduler tile so the formula is dispatched per tile
+ * and its inner loop is compiled for it alone */
+class EscapeTimeFractal : public FractalBase {
+public:
+    /* scalar type the pixels are iterated in, compute() takes the cheapest one that still
+     * resolves the pixel spacing */
+    enum class Precision { Float, Double, DoubleDouble, Perturbation };
+
+    EscapeTimeFractal(sf::Image *image, Viewport *vp, int maxIterations);
+
+    void compute() override;
+
+    /* Mariani-Silver: rectangles whose border agrees are filled instead of iterated,
+     * guard iterates a few filled pixels per rectangle and recomputes it on mismatch.
+     * Only applied to fractals whose set is connected */
+    void setSubdivision(bool enabled, bool guard);
+
+    /* keeps computed tiles across frames so revisited regions are not iterated again,
+     * spillDirectory empty keeps them in memory only */
+    void setTileCache(std::size_t budgetBytes,
+                      std::string const &spillDirectory,
+                      std::size_t spillBytes);
+
+    /* iteration field of the pixels x0 <= x < x1, y0 <= y < y1 of a width x height render of
+     * viewport, the values compute() gives them without tile cache or subdivision. The frame
+     * setup is kept while viewport and size stay the same, for rendering one picture in tiles */
+    std::vector<float> computeRegion(Viewport const &viewport,
+                                     unsigned width,
+                                     unsigned height,
+                                     unsigned x0,
+                                     unsigned y0,
+                                     unsigned x1,
+                                     unsigned y1);
+
+    /* maxIterations of the next frames becomes that share of the iteration limit */
+    void setIterationScale(double scale) override;
+
+    /* iterations at the initial 4 wide view, plus perDecade for every tenfold zoom past it,
+     * raised in half decade steps so most frames of a zoom can reuse the one before */
+    void setIterationLimit(int limit) override;
+    int iterationLimit() const override { return baseIterations; }
+    void setIterationsPerZoomDecade(int perDecade);
+
+    /* pixels that stop at the limit keep where they stopped and are CAPPED in the iteration
+     * field. Once the limit rises only they are iterated, from there if the frame is the same.
+     * Pixels proven inside by the bulb test or the periodicity check stay -1 for good */
+    void setIterationDeepening(bool enabled);
+    static constexpr float CAPPED = -2.0f;
+
+    /* colors by the exterior distance estimate in pixels instead of the iteration count, the
+     * exterior turns flat DISTANCE_SHADE_PIXELS away from the set. Skipping fills the disk the
+     * estimate of an escaped pixel proves that far out instead of iterating it, validation
+     * iterates the filled pixels anyway and reports those that differ. For fractals that
+     * estimate distances only */
+    void setDistanceEstimation(bool enabled, bool skipping, bool validation);
+    static constexpr double DISTANCE_SHADE_PIXELS = 4.0;
+
+    /* every frame in that precision instead of the one choosePrecision() picks, nullopt
+     * picks again. For comparing kernels across a switch point, the fractal must iterate it */
+    void setPrecisionOverride(std::optional<Precision> precision);
+
+    /* of the last frame */
+    int getMaxIterations() const { return maxIterations; }
+    Precision lastPrecision() const { return frame.precision; }
+    static const char *precisionName(Precision precision);
+
+protected:
+    /* geometry of the frame being computed, shared by the pixel loops */
+    struct Frame {
+        std::size_t width = 0, height = 0;
+        double left = 0.0, top = 0.0;
+        double dx = 0.0, dy = 0.0;
+        Precision precision = Precision::Double;
+        bool onLattice = false; // pixel (x, y) is lattice sample (gx0 + x, gy0 + y)
+        std::int64_t levelX = 0, levelY = 0;
+        std::int64_t gx0 = 0, gy0 = 0;
+        bool distance = false; // pixels are distance estimates, not iteration counts
+    };
+
+    /* iterates the pixels at the given indices of the current frame into values[0 .. count),
+     * one call per tile. states is null unless deepening: then each pixel starts from its
+     * state, n 0 from scratch, and leaves it there marked capped if it stops at the limit.
+     * A path that can not go on from a state leaves its n 0. In distance frames the values
+     * are distanceEstimate()s as in EscapeTime.hpp, in units of c */
+    virtual void computePixels(double *values,
+                               std::size_t const *indices,
+                               std::size_t count,
+                               EscapeState *states) = 0;
+    /* iterates points at fractional pixel positions of the current frame, pixel (x, y) at
+     * (x, y), for supersampling */
+    virtual void computeSamples(double *values,
+                                double const *px,
+                                double const *py,
+                                std::size_t count) const = 0;
+    /* one pixel, same result as computePixels */
+    virtual double computePixel(std::size_t idx) const = 0;
+    /* hash of the formula and its parameters, part of the tile cache key */
+    virtual std::uint64_t formulaHash() const = 0;
+
+    /* Double unless overridden */
+    virtual Precision choosePrecision(double spacing) const;
+    /* per frame setup once the frame geometry is known, frameVp already snapped */
+    virtual void prepareFrame(Viewport const &frameVp);
+    /* subdivision fills rectangles with an inside border, only sound if the set has no holes */
+    virtual bool connectedSet() const;
+    /* computePixels() can give distance estimates, false unless overridden */
+    virtual bool estimatesDistance() const;
+
+    void pixelToPoint(std::size_t idx, double &cr, double &ci) const;
+    void pointAt(double px, double py, double &cr, double &ci) const;
+
+    int maxIterations; // of the frame being computed
+    Frame frame;
+
+private:
+    /* inclusive pixel bounds */
+    struct PixelRect {
+        std::size_t x0, y0, x1, y1;
+    };
+
+    /* frame geometry and prepareFrame() for a width x height render of frameVp, snapped
+     * onto the lattice if asked */
+    void beginFrame(Viewport &frameVp, std::size_t width, std::size_t height, bool lattice);
+    void snapToLattice(Viewport &frameVp);
+    std::uint64_t paramsHash() const;
+    /* the pixels of the frame inside region only */
+    void fillFromTileCache(std::vector<double> &iterCounts, sf::IntRect const &region);
+    void storeToTileCache(std::vector<double> const &iterCounts, sf::IntRect const &region);
+
+    /* maxIterations for a frame of frameVp */
+    int frameIterations(Viewport const &frameVp) const;
+
+    /* computePixels() straight into the frame's iteration counts. With fill bounds the disks
+     * distance estimates prove flat are filled inside them */
+    void computeInto(double *iterCounts,
+                     std::size_t const *indices,
+                     std::size_t count,
+                     PixelRect const *fillBounds = nullptr);
+    /* a distance estimate in shading pixels, other values as they are */
+    double shade(double value) const;
+    void fillDisk(double *iterCounts, std::size_t idx, double distance, PixelRect const &bounds);
+    void validateDiskFill(std::vector<double> &iterCounts);
+
+    /* each of the disjoint regions on its own */
+    void subdivideFrame(std::vector<double> &iterCounts, std::vector<sf::IntRect> const &regions);
+    void subdivide(double *iterCounts, PixelRect rect);
+    void computeUnknown(double *iterCounts, std::vector<std::size_t> indices);
+    bool guardRect(std::vector<std::size_t> const &filled, double value) const;
+
+    void colorize(std::vector<double> const &iterCounts,
+                  std::size_t stride,
+                  std::vector<double> const *preview);
+
+    /* of the frame being computed. Once it is done the same as prevIterCounts, a pan moves
+     * it over and iterates only what it exposes */
+    std::vector<double> frameCounts;
+    bool countsKept = false; // frameCounts holds the last frame, not a cancelled one
+    std::vector<float> shownField; // progressive previews, gaps filled in
+
+    int baseIterations;
+    int iterationsPerDecade = 0;
+    double iterationScale = 1.0;
+    int prevIterations = 0; // maxIterations of the previous frame
+
+    /* deepening: pixels of the previous frame that stopped at the limit, sorted, and those of
+     * the frame being computed. While resuming the frame is the previous one at a higher limit
+     * and its pixels go on from cappedPixels */
+    bool deepening = false;
+    bool resuming = false;
+    using CappedPixel = std::pair<std::size_t, EscapeState>;
+    std::vector<CappedPixel> cappedPixels;
+    std::vector<CappedPixel> frameCapped;
+    std::mutex cappedMutex;
+
+    std::optional<Precision> precisionOverride;
+
+    bool distanceEnabled = false;
+    bool distanceSkipping = false;
+    bool distanceValidation = false;
+    std::atomic<std::size_t> diskFilledPixels{0};
+    std::vector<std::size_t> diskFilled; // with validation, under diskMutex
+    std::mutex diskMutex;
+
+    /* frame computeRegion() set up last, compute() replaces it */
+    bool regionFrameValid = false;
+    Viewport regionVp{};
+    std::size_t regionWidth = 0, regionHeight = 0;
+
+    /* grid spacing of the first progressive pass, halved every pass down to 1 */
+    static constexpr std::size_t PROGRESSIVE_FIRST_STRIDE = 8;
+
+    bool subdivisionEnabled = false;
+    bool subdivisionGuard = false;
+    static constexpr std::size_t SUBDIVISION_MIN_SIZE = 8;     // smaller rects are iterated
+    static constexpr std::size_t SUBDIVISION_TASK_AREA = 4096; // smaller rects stay on one thread
+    std::atomic<std::size_t> filledPixels{0};
+    std::atomic<std::size_t> guardFailures{0};
+
+    /* zoom levels per octave the lattice spacing is quantized to, snapping the frame onto
+     * it rescales the view by less than 2^(1/2/65536) */
+    static constexpr double LATTICE_LEVELS_PER_OCTAVE = 65536.0;
+    std::unique_ptr<TileCache> tileCache;
+};
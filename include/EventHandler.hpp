@@ -2,9 +2,13 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <AsyncRenderer.hpp>
 #include <FractalBase.hpp>
+#include <QualityController.hpp>
 #include <Viewport.hpp>
 
+#include <chrono>
+
 class EventHandler {
 public:
     EventHandler(sf::RenderWindow &window,
@@ -12,10 +16,13 @@ public:
                  std::unique_ptr<FractalBase> fractal,
                  sf::Image *image,
                  sf::Texture &texture,
-                 Viewport *viewport);
+                 Viewport *viewport,
+                 AntialiasParams posterAntialiasing,
+                 QualityParams interactiveQuality);
     void run();
 
 private:
+    void handleEvents();
     void handleQuitEvent(sf::RenderWindow &window);
     void handleArrowKeyEvent(sf::Event::KeyPressed const &e, Viewport *viewport);
     void handleMouseWheelEvent(const sf::Event::MouseWheelScrolled &e);
@@ -24,6 +31,8 @@ private:
     void handleMouseMoved();
     void handleZoomWithKeyboard(const sf::Event::KeyPressed &e);
     void handleSaveImageEvent();
+    void handleNextPaletteEvent();
+    void handleIterationLimitEvent(sf::Event::KeyPressed const &e);
 
     void applyZoomAtMouse(double zoomFactor);
     void updateViewportAndRedraw();
@@ -34,10 +43,17 @@ private:
     sf::Image *image;
     sf::Texture &texture;
     Viewport *viewport;
+    AntialiasParams posterAntialiasing;
+    AsyncRenderer renderer; // after fractal, stops rendering before the fractal goes away
 
     bool needsRedraw = false;
+    bool refinePending = false;
+    std::chrono::steady_clock::time_point lastInput;
+    /* input pause after which the interactive frame is refined to full quality */
+    static constexpr std::chrono::milliseconds REFINE_DELAY{150};
 
     bool dragging = false;
     sf::Vector2i lastMousePos;
     double zoom = 1.0;
+    std::size_t paletteIndex = 0;
 };
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Colorizer.hpp>
+#include <ConfigLoader.hpp>
+#include <Viewport.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* the picture a field file holds the iterations of */
+struct FieldHeader {
+    ConfigLoader::FractalParams fractal; // the parameters the tile protocol sends
+    Viewport viewport{};
+    std::uint32_t width = 0, height = 0;
+    std::uint32_t tileSize = 128;
+    ColorRange colorRange; // of the whole picture, coloring it again needs no preview
+};
+
+/* iteration field of a large picture on disk, written through mmap as its tiles finish, so an
+ * interrupted render goes on with the tiles still missing and a finished one can be colored
+ * again without iterating. In the host's byte order:
+ *   first page    magic, version, tile size, color range, the picture as a tile protocol job
+ *   next pages    completion bitmap, a bit per tile
+ *   then          the tiles row by row, each tileSize rows of tileSize floats, edges padded
+ * A tile's bit is only set once its values are on disk */
+class FieldFile {
+public:
+    /* creates the file with no tile done, throws std::runtime_error if it cannot be written */
+    FieldFile(std::string const &path, FieldHeader const &header);
+    /* maps an existing file, writable to go on rendering it. Throws std::runtime_error if it
+     * cannot be read or is not a field file of this version and byte order */
+    explicit FieldFile(std::string const &path, bool writable = false);
+    ~FieldFile();
+
+    FieldFile(FieldFile const &) = delete;
+    FieldFile &operator=(FieldFile const &) = delete;
+
+    FieldHeader const &header() const { return fileHeader; }
+    std::size_t tilesX() const { return columns; }
+    std::size_t tileCount() const { return columns * tileRows; }
+    bool tileDone(std::size_t tile) const;
+    std::size_t tilesDone() const;
+
+    /* the tile's tileSize x tileSize values in the mapping, valid while the file is open */
+    float const *tile(std::size_t tile) const;
+    /* rows y0 .. y0 + rows - 1 gathered from their tiles, width values each */
+    void readRows(unsigned y0, unsigned rows, float *field) const;
+
+    /* field holds the tile's pixels row major, as many per row as the picture has there.
+     * The tile counts as done after the next sync() */
+    void writeTile(std::size_t tile, float const *field);
+    /* puts the tiles written so far on disk, then marks them done. Throws std::runtime_error
+     * if the file cannot be synced */
+    void sync();
+
+private:
+    /* close the file on failure */
+    void map(std::size_t bytes);
+    void unmap();
+    void readHeader(std::string const &path);
+    unsigned char *bitmap() const { return mapping + BITMAP_OFFSET; }
+
+    int fd = -1;
+    bool writable = false;
+    unsigned char *mapping = nullptr;
+    std::size_t mappedBytes = 0;
+    std::size_t dataOffset = 0;
+    std::size_t tileBytes = 0;
+    std::size_t columns = 0, tileRows = 0;
+    FieldHeader fileHeader;
+    std::vector<std::size_t> unsynced; // written, not yet marked done
+
+    static constexpr std::uint32_t VERSION = 2;
+    static constexpr std::size_t BITMAP_OFFSET = 4096; // the header page
+};
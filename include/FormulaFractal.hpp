@@ -0,0 +1,115 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <EscapeTimeFractal.hpp>
+#include <Formulas.hpp>
+#include <Profiler.hpp>
+
+#include <cmath>
+
+/* escape-time fractal for one of the formulas in Formulas.hpp, dispatched once per tile:
+ * the pixel loop below is instantiated per formula with its step inlined */
+template <typename Formula> class FormulaFractal final : public EscapeTimeFractal {
+public:
+    FormulaFractal(sf::Image *image, Viewport *vp, Formula formula = {})
+        : EscapeTimeFractal(image, vp, 2000),
+          formula(formula) {}
+
+    double computePoint(double x, double y) const override { return iterate(x, y, nullptr); }
+
+protected:
+    void computePixels(double *values,
+                       std::size_t const *indices,
+                       std::size_t count,
+                       EscapeState *states) override {
+        PROFILE_COUNT(Pixels, count);
+        for (std::size_t i = 0; i < count; i++) {
+            double x, y;
+            pixelToPoint(indices[i], x, y);
+            values[i] = iterate(x, y, states ? states + i : nullptr);
+        }
+    }
+
+    void computeSamples(double *values,
+                        double const *px,
+                        double const *py,
+                        std::size_t count) const override {
+        for (std::size_t i = 0; i < count; i++) {
+            double x, y;
+            pointAt(px[i], py[i], x, y);
+            values[i] = iterate(x, y, nullptr);
+        }
+    }
+
+    double computePixel(std::size_t idx) const override {
+        double x, y;
+        pixelToPoint(idx, x, y);
+        return iterate(x, y, nullptr);
+    }
+
+    std::uint64_t formulaHash() const override { return formula.hash(); }
+    bool connectedSet() const override { return formula.connected(); }
+
+private:
+    /* escapeTime() of EscapeTime.hpp for this formula: same periodicity check and state,
+     * smoothing for its power, no cardioid test */
+    double iterate(double x, double y, EscapeState *state) const {
+        double zr, zi, cr, ci;
+        formula.start(x, y, zr, zi, cr, ci);
+        double zrOld = zr, ziOld = zi;
+        int checkPeriod = 20;
+        int nextCheck = checkPeriod;
+        int n = 0;
+        if (state && state->n > 0) {
+            zr = state->zr, zi = state->zi;
+            zrOld = state->zrOld, ziOld = state->ziOld;
+            checkPeriod = state->checkPeriod;
+            nextCheck = state->nextCheck;
+            n = state->n;
+        }
+        double zr2 = zr * zr, zi2 = zi * zi;
+        int start = n;
+        while (zr2 + zi2 <= 4.0 && n < maxIterations) {
+            Formula::step(zr, zi, zr2, zi2, cr, ci);
+            zr2 = zr * zr;
+            zi2 = zi * zi;
+            ++n;
+            if (n == nextCheck) {
+                double diffR = zr - zrOld;
+                double diffI = zi - ziOld;
+                if (diffR * diffR + diffI * diffI < 1e-20) {
+                    PROFILE_COUNT(PeriodicExits, 1);
+                    PROFILE_COUNT(Iterations, n - start);
+                    return -1;
+                }
+                zrOld = zr;
+                ziOld = zi;
+                nextCheck += checkPeriod;
+                checkPeriod *= 2;
+            }
+        }
+        PROFILE_COUNT(Iterations, n - start);
+        if (n == maxIterations) {
+            if (state) {
+                *state = {zr, zi, zrOld, ziOld, n, nextCheck, checkPeriod, 0, true};
+            }
+            return -1;
+        }
+        // |z| grows like |z|^POWER per step past the escape radius
+        double log2Modulus = std::log2(zr2 + zi2) / 2.0;
+        return n + 1.0 - std::log2(log2Modulus) / std::log2(double(Formula::POWER));
+    }
+
+    Formula formula;
+};
+
+extern template class FormulaFractal<formula::Julia>;
+extern template class FormulaFractal<formula::BurningShip>;
+extern template class FormulaFractal<formula::Tricorn>;
+extern template class FormulaFractal<formula::Multibrot<3>>;
+extern template class FormulaFractal<formula::Multibrot<4>>;
+extern template class FormulaFractal<formula::Multibrot<5>>;
+extern template class FormulaFractal<formula::Multibrot<6>>;
+extern template class FormulaFractal<formula::Multibrot<7>>;
+extern template class FormulaFractal<formula::Multibrot<8>>;
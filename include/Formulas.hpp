@@ -0,0 +1,106 @@
+#pragma once
+
+#include <EscapeTime.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/* iteration rules of the fractal family. Everything FormulaFractal needs per pixel is inline
+ * and the power a compile-time constant, so each formula gets its own inner loop.
+ * start() maps the pixel's point to the first z and the c of its orbit, step() applies
+ * z -> f(z) + c given zr2 = zr^2 and zi2 = zi^2 */
+namespace formula {
+
+/* z^N + c, N = 2 is the Mandelbrot set which has its own SIMD kernel */
+template <int N> struct Multibrot {
+    static_assert(N >= 3, "power 2 is Mandelbrot");
+    static constexpr int POWER = N;
+
+    void start(double x, double y, double &zr, double &zi, double &cr, double &ci) const {
+        zr = zi = 0.0;
+        cr = x;
+        ci = y;
+    }
+
+    static void step(double &zr, double &zi, double zr2, double zi2, double cr, double ci) {
+        // z^N by N - 1 multiplications, unrolled for the constant N
+        double pr = zr2 - zi2, pi = 2.0 * zr * zi;
+        for (int k = 2; k < N; k++) {
+            double t = pr * zr - pi * zi;
+            pi = pr * zi + pi * zr;
+            pr = t;
+        }
+        zr = pr + cr;
+        zi = pi + ci;
+    }
+
+    bool connected() const { return true; }
+    std::uint64_t hash() const { return std::hash<std::string>{}("Multibrot") ^ N; }
+};
+
+/* z^2 + c for a fixed c, the pixel is the starting z */
+struct Julia {
+    static constexpr int POWER = 2;
+    double cr = -0.8, ci = 0.156;
+
+    void start(double x, double y, double &zr, double &zi, double &cr0, double &ci0) const {
+        zr = x;
+        zi = y;
+        cr0 = cr;
+        ci0 = ci;
+    }
+
+    static void step(double &zr, double &zi, double zr2, double zi2, double cr, double ci) {
+        zi = 2.0 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+    }
+
+    // the Julia set is connected exactly when c is in the Mandelbrot set
+    bool connected() const { return escapeTime(cr, ci, 2000) < 0.0; }
+    std::uint64_t hash() const {
+        return std::hash<std::string>{}("Julia") ^ std::hash<double>{}(cr) ^
+               (std::hash<double>{}(ci) * 0x9e3779b97f4a7c15ull);
+    }
+};
+
+/* (|zr| + i |zi|)^2 + c, imaginary axis flipped so the ship stands upright */
+struct BurningShip {
+    static constexpr int POWER = 2;
+
+    void start(double x, double y, double &zr, double &zi, double &cr, double &ci) const {
+        zr = zi = 0.0;
+        cr = x;
+        ci = -y;
+    }
+
+    static void step(double &zr, double &zi, double zr2, double zi2, double cr, double ci) {
+        zi = 2.0 * std::abs(zr * zi) + ci;
+        zr = zr2 - zi2 + cr;
+    }
+
+    bool connected() const { return false; }
+    std::uint64_t hash() const { return std::hash<std::string>{}("BurningShip"); }
+};
+
+/* conj(z)^2 + c, the Mandelbar set */
+struct Tricorn {
+    static constexpr int POWER = 2;
+
+    void start(double x, double y, double &zr, double &zi, double &cr, double &ci) const {
+        zr = zi = 0.0;
+        cr = x;
+        ci = y;
+    }
+
+    static void step(double &zr, double &zi, double zr2, double zi2, double cr, double ci) {
+        zi = -2.0 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+    }
+
+    bool connected() const { return true; }
+    std::uint64_t hash() const { return std::hash<std::string>{}("Tricorn"); }
+};
+
+} // namespace formula
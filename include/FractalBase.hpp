@@ -2,12 +2,35 @@
 
 #include <SFML/Graphics.hpp>
 
+#include <Antialiaser.hpp>
+#include <Colorizer.hpp>
 #include <Viewport.hpp>
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
+/* what the last compute() did, for benchmarks */
+struct FrameStats {
+    std::size_t pixels = 0;
+    std::size_t reusedPixels = 0; // taken from the previous frame or the tile cache
+    std::size_t resumedPixels = 0; // went on from where a lower iteration limit stopped them
+    std::size_t diskFilledPixels = 0; // proven flat by a distance estimate, not iterated
+    std::vector<double> workerUtilization; // busy / wall time of every worker
+    AntialiasStats antialias;
+};
+
+/* what the last compute() changed in its image. Every pixel unless partial: then the image
+ * before it moved so pixel (x, y) shows what was at (x + shift.x, y + shift.y), and only the
+ * rects were drawn anew */
+struct ImageUpdate {
+    bool partial = false;
+    sf::Vector2i shift{};
+    std::vector<sf::IntRect> rects;
+};
+
 class FractalBase {
 public:
     virtual ~FractalBase() = default;
@@ -18,17 +41,84 @@ public:
     /* returns iteration count of a single point, or -1 if inside set */
     virtual double computePoint(double x, double y) const = 0;
 
+    void setTarget(sf::Image *newImage, Viewport *newVp);
     void backupAndReplacePointers(sf::Image *newImage, Viewport *newVp);
     void restoreBackedUpPointers();
 
+    /* makes compute() render coarse to fine, the callback runs after every coarse pass
+     * with the image filled so far. Empty callback for a single full resolution pass */
+    void setProgressCallback(std::function<void()> callback);
+
+    /* iteration field of the last complete frame, -1 inside the set, below -1 not known to
+     * escape within the limit but not proven inside either */
+    std::vector<float> const &iterationField() const { return prevIterCounts; }
+    FrameStats lastFrameStats() const { return frameStats; }
+    ImageUpdate const &lastImageUpdate() const { return imageUpdate; }
+
+    /* the next compute() starts over as if it were the first, nothing of the last frame is
+     * reused. Its buffers stay allocated for it */
+    void forgetPreviousFrame();
+
+    /* recolors the last frame into the image, the palette or range changed but not the view */
+    void setPalette(std::vector<sf::Color> palette);
+    void recolor();
+
+    /* colors every compute() against this range instead of the frame's own, so separately
+     * computed parts of one picture match. lastColorRange() is what the last frame used */
+    void lockColorRange(ColorRange range);
+    void unlockColorRange();
+    ColorRange lastColorRange() const { return colorRange; }
+
+    /* supersamples the edges of every compute() into the image, off with maxSamples 0. The
+     * iteration field keeps one sample per pixel, recolor() shows it without */
+    void setAntialiasing(AntialiasParams params) { antialiasing = params; }
+    AntialiasParams getAntialiasing() const { return antialiasing; }
+
+    /* iterates every compute() up to this fraction of the fractal's iteration limit, 1 for
+     * all of it. Quick interactive frames, ignored by fractals without a limit */
+    virtual void setIterationScale(double scale) {}
+
+    /* iterations a point gets before it counts as inside, 0 for fractals without a limit.
+     * At most MAX_ITERATION_LIMIT, float lanes count iterations exactly up to 2^24 */
+    virtual void setIterationLimit(int limit) {}
+    virtual int iterationLimit() const { return 0; }
+    static constexpr int MAX_ITERATION_LIMIT = 1 << 24;
+
+    /* thread safe, abandons the compute() in flight at its next row, image left partial */
+    void requestCancel() { cancelFlag.store(true, std::memory_order_relaxed); }
+    void clearCancel() { cancelFlag.store(false, std::memory_order_relaxed); }
+    bool cancelRequested() const { return cancelFlag.load(std::memory_order_relaxed); }
+
 protected:
     sf::Image *image;
     Viewport *vp;
     sf::Image *backupImage = nullptr;
     Viewport *backupVp = nullptr;
 
-    /* previous iter counts for potential re-use */
-    std::vector<double> prevIterCounts;
+    std::function<void()> progressCallback;
+    std::atomic<bool> cancelFlag{false};
+    FrameStats frameStats;
+    ImageUpdate imageUpdate;
+
+    /* the locked range, else the field's own which lastColorRange() then reports */
+    ColorRange rangeOf(std::vector<float> const &field);
+    /* colors the field into the image, same size */
+    void colorizeField(std::vector<float> const &field, ColorRange range);
+
+    Colorizer colorizer;
+    std::vector<std::uint8_t> pixelBuffer;
+    /* pixelBuffer is prevIterCounts colored in pixelRange with the current palette and
+     * nothing else, a pan can move it along */
+    bool pixelsOfPrevField = false;
+    ColorRange pixelRange;
+    ColorRange colorRange;
+    bool colorRangeLocked = false;
+    AntialiasParams antialiasing;
+
+    /* iteration field of the last complete frame, for recoloring and potential re-use */
+    std::vector<float> prevIterCounts;
+    ColorRange prevColorRange;
     Viewport prevVp{};
+    sf::Vector2u prevSize{};
     bool hasPrevVp = false;
-};
\ No newline at end of file
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <ConfigLoader.hpp>
+#include <EscapeTimeFractal.hpp>
+#include <Viewport.hpp>
+
+#include <memory>
+#include <string>
+
+/* Buddhabrot and Nebulabrot are density fractals, not escape-time ones */
+bool isDensityFractal(std::string const &name);
+
+/* the density fractal named by params.name, throws std::runtime_error for any other name
+ * or an empty list of limits */
+std::unique_ptr<FractalBase> makeDensityFractal(ConfigLoader::FractalParams const &params,
+                                                ConfigLoader::DensityParams const &density,
+                                                sf::Image *image,
+                                                Viewport *vp);
+
+/* the fractal named by params.name with the options of params applied,
+ * throws std::runtime_error for an unknown name or an unsupported power */
+std::unique_ptr<EscapeTimeFractal> makeFractal(ConfigLoader::FractalParams const &params,
+                                               sf::Image *image,
+                                               Viewport *vp);
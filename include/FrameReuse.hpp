@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <Viewport.hpp>
+
+#include <vector>
+
+/* where the pixels of a new frame fall on the previous frame's pixel grid, for pans and zooms:
+ * pixel (x, y) samples the same point as previous pixel (offsetX + x scaleX, offsetY + y scaleY) */
+class FrameReuse {
+public:
+    FrameReuse(Viewport const &prevVp,
+               sf::Vector2u prevSize,
+               Viewport const &vp,
+               sf::Vector2u size);
+
+    /* copies previous samples that sit exactly on a pixel of the new frame, returns how many */
+    std::size_t reuseAligned(std::vector<float> const &prev, std::vector<double> &next) const;
+
+    /* nearest previous sample for every pixel still NaN, only good enough for a preview */
+    void reproject(std::vector<float> const &prev, std::vector<double> &preview) const;
+
+    /* the frame is the previous one moved by whole pixels at the same size and spacing, pixel
+     * (x, y) is previous pixel (x + shift.x, y + shift.y). False if nothing of it is left */
+    bool wholePixelShift(sf::Vector2i &shift) const;
+
+    /* pixels of a frame moved by shift that were not in the previous one: a band across and
+     * a band down, disjoint */
+    static std::vector<sf::IntRect> exposedRects(sf::Vector2u size, sf::Vector2i shift);
+
+    /* moves a frame of pixelBytes per pixel in place by shift as above, a memmove per row.
+     * The exposed pixels keep stale values */
+    static void
+    shiftPixels(void *pixels, std::size_t pixelBytes, sf::Vector2u size, sf::Vector2i shift);
+
+private:
+    /* source column/row per destination column/row, -1 when it falls off the previous frame
+     * or between samples */
+    std::vector<long>
+    alignedSources(double offset, double scale, unsigned count, unsigned prevCount) const;
+    std::vector<long>
+    nearestSources(double offset, double scale, unsigned count, unsigned prevCount) const;
+
+    sf::Vector2u prevSize;
+    sf::Vector2u size;
+    double offsetX, offsetY;
+    double scaleX, scaleY;
+
+    /* in pixels, samples closer than this to a pixel count as the same point */
+    static constexpr double ALIGN_TOLERANCE = 1e-6;
+};
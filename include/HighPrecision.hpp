@@ -0,0 +1,8 @@
+#pragma once
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+
+/* 1024 bits keeps the viewport center exact down to pixel spacings near the double range limit */
+using HPReal = boost::multiprecision::number<
+    boost::multiprecision::cpp_bin_float<1024, boost::multiprecision::digit_base_2>,
+    boost::multiprecision::et_off>;
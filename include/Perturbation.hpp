@@ -0,0 +1,36 @@
+#pragma once
+
+#include <HighPrecision.hpp>
+
+#include <vector>
+
+/* orbit of a single point iterated in high precision, stored rounded to double:
+ * pixels then only iterate their small delta against it */
+class ReferenceOrbit {
+public:
+    void compute(HPReal const &cr, HPReal const &ci, int maxIterations);
+
+    /* number of stored points Z_0 .. Z_{size-1}, the last one is either escaped or Z_maxIterations */
+    int size() const { return static_cast<int>(zr.size()); }
+
+    std::vector<double> zr;
+    std::vector<double> zi;
+};
+
+/* cubic series for the deltas, delta_n = a u + b u^2 + c u^3 with u = dc / maxDelta,
+ * lets every pixel start at iteration skip() instead of 0 */
+class SeriesApproximation {
+public:
+    void compute(ReferenceOrbit const &orbit, double maxDelta, int maxIterations);
+
+    int skip() const { return skipIterations; }
+    void evaluate(double dcr, double dci, double &dzr, double &dzi) const;
+
+private:
+    int skipIterations = 0;
+    double invMaxDelta = 0.0;
+    // coefficients scaled by powers of maxDelta so they stay in range at any depth
+    double ar = 0.0, ai = 0.0;
+    double br = 0.0, bi = 0.0;
+    double cr = 0.0, ci = 0.0;
+};
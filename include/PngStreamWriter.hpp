@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/* writes a PNG row by row, so an image never has to be in memory whole.
+ * Takes RGBA rows and stores RGB, throws std::runtime_error on failure */
+class PngStreamWriter {
+public:
+    PngStreamWriter(std::string const &filename, unsigned width, unsigned height);
+    ~PngStreamWriter();
+
+    PngStreamWriter(PngStreamWriter const &) = delete;
+    PngStreamWriter &operator=(PngStreamWriter const &) = delete;
+
+    void writeRows(std::uint8_t const *rgba, unsigned rows);
+
+    /* writes the end of the file, must follow the last row */
+    void finish();
+
+private:
+    void release();
+
+    std::string filename;
+    unsigned height;
+    unsigned rowsWritten = 0;
+    std::FILE *file = nullptr;
+    void *png = nullptr; // png_structp, libpng stays out of the header
+    void *info = nullptr;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <FractalBase.hpp>
+#include <Viewport.hpp>
+
+#include <cstddef>
+#include <string>
+
+/* renders images far bigger than memory in horizontal strips streamed into a PNG.
+ * A low resolution pre-pass fixes the color range so the strips match, the edges of the
+ * strips are supersampled with antialiasing */
+class PosterExporter {
+public:
+    explicit PosterExporter(FractalBase &fractal, AntialiasParams antialiasing = {});
+
+    /* throws std::runtime_error if the file cannot be written */
+    void save(Viewport const &viewport, unsigned width, unsigned height, std::string const &filename);
+
+private:
+    ColorRange preview(Viewport const &viewport, unsigned width, unsigned height);
+
+    FractalBase &fractal;
+    AntialiasParams antialiasing;
+
+    /* pixels per strip, bounds memory whatever the poster size: about 20 bytes each
+     * for the strip image, its iteration counts and the ones kept for reuse */
+    static constexpr std::size_t STRIP_PIXELS = std::size_t(1) << 22;
+    static constexpr unsigned PREVIEW_WIDTH = 1024;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+/* per scalar type constants of the escape-time loop, data only so the per-isa translation
+ * units can include it */
+template <typename T> struct PrecisionTraits;
+
+template <> struct PrecisionTraits<float> {
+    // a few float ulp at |z| ~ 1
+    static constexpr float PERIOD_TOLERANCE = 1e-12f;
+    // |z - saved z|^2 below which a cycle is worth proving, and the Newton step it ends at
+    static constexpr float CYCLE_TOLERANCE = 1e-8f;
+    static constexpr float NEWTON_TOLERANCE = 1e-12f;
+    // the derivative modulus is held above it, so that times a small |z|^2 is no denormal
+    static constexpr float DERIVATIVE_FLOOR = 1e-10f;
+};
+
+template <> struct PrecisionTraits<double> {
+    static constexpr double PERIOD_TOLERANCE = 1e-20;
+    static constexpr double CYCLE_TOLERANCE = 1e-12;
+    static constexpr double NEWTON_TOLERANCE = 1e-24;
+    static constexpr double DERIVATIVE_FLOOR = 1e-100;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/* phase timers and per-thread counters for finding out where a frame goes.
+ * Only active when built with FRACTAL_PROFILING (cmake -DFRACTAL_PROFILING=ON), otherwise
+ * the macros expand to nothing. The counting functions are out of line on purpose: they are
+ * called from the per-isa kernels, which must not instantiate any shared inline code */
+class Profiler {
+public:
+    enum class Counter {
+        Pixels,                  // iterated by a kernel
+        Iterations,              // z -> z^2 + c steps actually taken
+        BulbSkips,               // inside the main cardioid or period 2 bulb, no iterating
+        PeriodicExits,           // stopped early by the periodicity check or a cycle proof
+        HintedExits,             // of those, proven with the period of the pixel before
+        ProofIterations,         // spent in the Newton steps of cycle proofs, failed ones too
+        SavedIterations,         // limit minus the iterations of the pixels proven inside
+        SeriesSkippedIterations, // jumped over by the series approximation
+        ReusedPixels,            // copied from the previous frame
+        CachedPixels,            // copied from the tile cache
+        FilledPixels,            // filled by subdivision
+        DiskFilledPixels,        // filled from distance estimates
+        Count
+    };
+
+    /* times the enclosing block on the calling thread */
+    class Scope {
+    public:
+        explicit Scope(char const *name);
+        ~Scope();
+
+        Scope(Scope const &) = delete;
+        Scope &operator=(Scope const &) = delete;
+
+    private:
+        char const *name;
+        std::int64_t start;
+    };
+
+    static constexpr bool enabled() {
+#ifdef FRACTAL_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static void count(Counter counter, std::uint64_t n);
+
+    /* the ones below expect no thread to be recording meanwhile */
+
+    /* time per phase over all threads, then the counters of every thread */
+    static void report(std::ostream &out);
+    /* trace_event JSON for chrome://tracing or Perfetto, false if the file cannot be written */
+    static bool writeChromeTrace(std::string const &path);
+    /* a counter summed over threads */
+    static std::uint64_t total(Counter counter);
+
+    static char const *counterName(Counter counter);
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef FRACTAL_PROFILING
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, n) Profiler::count(Profiler::Counter::counter, (n))
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, n) ((void)sizeof(n))
+#endif
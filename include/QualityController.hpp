@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+struct QualityParams {
+    double frameBudget = 0.016;        // seconds an interactive frame may take
+    double minScale = 0.125;           // lowest resolution, of the window's width and height
+    double minIterationScale = 0.125;  // lowest iteration limit, of maxIterations
+};
+
+/* how a frame is rendered, full quality is 1 and 1 */
+struct QualityLevel {
+    double scale = 1.0;          // resolution, power of two fraction of the window's
+    double iterationScale = 1.0; // of maxIterations
+
+    bool full() const { return scale >= 1.0 && iterationScale >= 1.0; }
+};
+
+/* picks the quality of interactive frames from the measured frame times so they fit the frame
+ * budget: resolution halved first, the iteration limit lowered once the resolution is at its
+ * minimum. No clock or window inside, frame times come from record() */
+class QualityController {
+public:
+    explicit QualityController(QualityParams params = {});
+
+    /* for the next frame while the view moves, full quality until a frame was measured */
+    QualityLevel interactive() const;
+
+    /* a frame rendered at level took seconds */
+    void record(QualityLevel level, double seconds);
+    /* a frame at level was cancelled after seconds, a lower bound on what it would have
+     * taken: the estimate only rises to it. While every frame of a drag is cancelled by the
+     * next input these are the only timings */
+    void recordCancelled(QualityLevel level, double seconds);
+
+    /* levels after from to reach full quality once input stops, the resolution doubled every
+     * pass and the iteration limit restored by the last one. Empty if from is full */
+    std::vector<QualityLevel> refinement(QualityLevel from) const;
+
+    double lastFrameSeconds() const { return lastSeconds; }
+    /* estimated seconds of a full quality frame, 0 until a frame was measured */
+    double fullFrameSeconds() const { return estimate; }
+
+private:
+    /* of a full quality frame, pixels times iterations */
+    static double cost(QualityLevel level);
+
+    QualityParams params;
+    double estimate = 0.0;
+    double lastSeconds = 0.0;
+
+    /* weight of the newest frame in the estimate, a single slow frame does not drop the
+     * resolution on its own */
+    static constexpr double SMOOTHING = 0.5;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <ConfigLoader.hpp>
+#include <FieldFile.hpp>
+#include <Viewport.hpp>
+
+#include <sys/types.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* what the last render() took */
+struct ClusterStats {
+    std::size_t tiles = 0;
+    std::size_t failedTiles = 0;    // sent again after a worker died or reported an error
+    std::size_t duplicatedTiles = 0; // slow tiles also sent to an idle worker
+    std::size_t lostWorkers = 0;
+    std::size_t compressedBytes = 0; // received, against 4 bytes per pixel uncompressed
+    std::size_t resumedTiles = 0;    // read back from the field file instead
+    std::vector<std::size_t> tilesPerWorker;
+};
+
+/* renders one picture as tiles on worker processes. Each worker is started as
+ * /bin/sh -c command and speaks TileProtocol on its stdin and stdout, so "fractal_worker"
+ * runs one locally and "ssh node fractal_worker" one on another node. Workers iterate with
+ * EscapeTimeFractal::computeRegion(), so the assembled field is the one a local compute()
+ * without tile cache or subdivision gives. Tiles of a worker that dies or reports an error
+ * go to another one, tiles taking far longer than the others are sent to an idle worker as
+ * well and the first result wins */
+class RenderCluster {
+public:
+    RenderCluster(std::vector<std::string> const &workerCommands,
+                  ConfigLoader::FractalParams const &params);
+    ~RenderCluster();
+
+    RenderCluster(RenderCluster const &) = delete;
+    RenderCluster &operator=(RenderCluster const &) = delete;
+
+    /* hands rows(y0, count, field) the picture top to bottom in bands of rows, field holds
+     * width * count values. Only a few bands are in memory at a time whatever the picture
+     * size. Throws std::runtime_error once no worker is left or a tile failed MAX_ATTEMPTS
+     * times. With a field file of this picture and TILE_SIZE the tiles done in it are read
+     * back instead of rendered, the others are written to it as they arrive */
+    void render(Viewport const &viewport,
+                unsigned width,
+                unsigned height,
+                std::function<void(unsigned, unsigned, float const *)> const &rows,
+                std::ostream &log,
+                FieldFile *field = nullptr);
+    /* the whole iteration field, -1 inside the set */
+    std::vector<float>
+    render(Viewport const &viewport, unsigned width, unsigned height, std::ostream &log);
+
+    std::size_t liveWorkers() const;
+    ClusterStats lastStats() const { return stats; }
+
+    /* square tiles, a job is about 64 KB of iterations before compression */
+    static constexpr unsigned TILE_SIZE = 128;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        std::uint32_t id;
+        Clock::time_point sent;
+    };
+
+    struct Worker {
+        std::string command;
+        pid_t pid = -1;
+        int fd = -1; // socket on the worker's stdin and stdout
+        bool alive = false;
+        std::deque<Job> jobs; // in the order the worker answers them
+        Clock::time_point lastAnswer;
+    };
+
+    struct Tile {
+        unsigned x0, y0, x1, y1;
+        bool done = false;
+        unsigned copies = 0; // jobs in flight
+        unsigned failures = 0;
+    };
+
+    void start(Worker &worker);
+    void stop(Worker &worker);
+    /* the worker's jobs go back to the queue, throws if a tile ran out of attempts */
+    void lose(std::size_t worker, std::string const &why, std::ostream &log);
+    /* false if the worker is gone, the tile is not sent then */
+    bool send(std::size_t worker, std::size_t tile, std::ostream &log);
+    void receive(std::size_t worker, std::ostream &log);
+    /* the tile's values into its band, stride apart row to row */
+    void store(std::size_t tile, float const *values, std::size_t stride);
+    /* back to the front of the queue, throws once it ran out of attempts */
+    void failed(std::size_t tile, std::string const &why);
+    /* a tile in flight far longer than finished ones took and not on worker, or -1 */
+    long slowTile(std::size_t worker) const;
+
+    std::vector<Worker> workers;
+    ConfigLoader::FractalParams params;
+
+    /* the render in progress */
+    Viewport renderVp{};
+    unsigned renderWidth = 0, renderHeight = 0;
+    std::vector<Tile> tiles;
+    std::deque<std::size_t> queue;
+    std::unordered_map<std::uint32_t, std::size_t> jobTiles; // ids of older renders are gone
+    std::uint32_t nextJobId = 0;
+    std::vector<std::vector<float>> bands; // one per row of tiles, empty once handed out
+    std::vector<std::size_t> bandTilesLeft;
+    FieldFile *field = nullptr;
+    double finishedSeconds = 0.0;
+    std::size_t finishedTiles = 0;
+    ClusterStats stats;
+
+    static constexpr std::size_t JOBS_PER_WORKER = 2; // one computing, the next one waiting
+    static constexpr unsigned MAX_ATTEMPTS = 3;
+    /* a tile is slow after this many times the mean tile time, and at least a second */
+    static constexpr double SLOW_TILE_FACTOR = 4.0;
+    static constexpr double SLOW_TILE_MIN_SECONDS = 1.0;
+    static constexpr int POLL_MILLISECONDS = 100;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <EscapeState.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+/* batched escape-time kernel, picks the widest instruction set the cpu supports at runtime.
+ * Results are bit-identical to escapeTime<double> (escapeTime<float> for the float variant)
+ * in EscapeTime.hpp: same operation order, no fused multiply-add, smoothing in scalar code */
+class SimdKernel {
+public:
+    enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+    explicit SimdKernel(int maxIterations);
+
+    /* out[i] = escapeTime(cr[i], ci[i], states + i), iteration count or -1 if inside set.
+     * states is optional, a state to resume from must have stopped below maxIterations.
+     * Without states every point first tries the period a point before it was proven inside
+     * with, which only changes how fast the inside is found */
+    void computePoints(const double *cr,
+                       const double *ci,
+                       std::size_t count,
+                       double *out,
+                       EscapeState *states = nullptr) const;
+
+    /* same in single precision, twice the lanes, only accurate at shallow zoom. The lanes
+     * count iterations in float, above FLOAT_MAX_ITERATIONS computePoints() runs instead */
+    void computePointsFloat(const double *cr,
+                            const double *ci,
+                            std::size_t count,
+                            double *out,
+                            EscapeState *states = nullptr) const;
+
+    void setMaxIterations(int limit) { maxIterations = limit; }
+    static constexpr int FLOAT_MAX_ITERATIONS = 1 << 24; // n + 1 != n in float up to there
+
+    Isa isa() const { return selectedIsa; }
+    void setIsa(Isa isa);
+
+    static Isa detectIsa();
+    static const char *isaName(Isa isa);
+
+private:
+    /* writes the escape iteration (-1 if inside) and the final |z|^2 of every point */
+    using BatchFn = void (*)(const double *cr,
+                             const double *ci,
+                             std::size_t count,
+                             int maxIterations,
+                             int *iterations,
+                             double *modulus2,
+                             EscapeState *states);
+
+    void runBatch(BatchFn fn,
+                  const double *cr,
+                  const double *ci,
+                  std::size_t count,
+                  double *out,
+                  EscapeState *states) const;
+
+    int maxIterations;
+    Isa selectedIsa = Isa::Scalar;
+    BatchFn batch = nullptr;
+    BatchFn batchFloat = nullptr;
+};
+
+/* attractingCycle() of EscapeTime.hpp compiled without -m flags, for the per-isa kernels:
+ * instantiating it there would leak vector code into the other translation units */
+bool attractingCycleOutOfLine(
+    float cr, float ci, float zr, float zi, int period, std::uint64_t &cost);
+bool attractingCycleOutOfLine(
+    double cr, double ci, double zr, double zi, int period, std::uint64_t &cost);
+
+#if defined(__x86_64__) || defined(__i386__)
+/* one pair per translation unit, each compiled with its own -m flags */
+void escapeTimeBatchSse2(const double *cr,
+                         const double *ci,
+                         std::size_t count,
+                         int maxIterations,
+                         int *iterations,
+                         double *modulus2,
+                         EscapeState *states);
+void escapeTimeBatchSse2Float(const double *cr,
+                              const double *ci,
+                              std::size_t count,
+                              int maxIterations,
+                              int *iterations,
+                              double *modulus2,
+                              EscapeState *states);
+void escapeTimeBatchAvx2(const double *cr,
+                         const double *ci,
+                         std::size_t count,
+                         int maxIterations,
+                         int *iterations,
+                         double *modulus2,
+                         EscapeState *states);
+void escapeTimeBatchAvx2Float(const double *cr,
+                              const double *ci,
+                              std::size_t count,
+                              int maxIterations,
+                              int *iterations,
+                              double *modulus2,
+                              EscapeState *states);
+void escapeTimeBatchAvx512(const double *cr,
+                           const double *ci,
+                           std::size_t count,
+                           int maxIterations,
+                           int *iterations,
+                           double *modulus2,
+                           EscapeState *states);
+void escapeTimeBatchAvx512Float(const double *cr,
+                                const double *ci,
+                                std::size_t count,
+                                int maxIterations,
+                                int *iterations,
+                                double *modulus2,
+                                EscapeState *states);
+#endif
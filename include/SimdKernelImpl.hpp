@@ -0,0 +1,251 @@
+#pragma once
+
+#include <EscapeState.hpp>
+#include <Precision.hpp>
+#include <Profiler.hpp>
+#include <SimdKernel.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/* generic lane-group escape-time loop, only included by the per-isa translation units.
+ * Ops wraps the intrinsics of one instruction set: V is a vector of T (float or double),
+ * M a lane mask.
+ * Every lane follows escapeTime() in EscapeTime.hpp operation for operation, a lane that
+ * finishes is refilled with the next point right away so no lane idles behind a slow one.
+ * A lane with a cycle to prove leaves the vectors for the scalar proof and goes on if it fails.
+ * Everything here has internal linkage: nothing compiled with -mavx* may leak to other units */
+
+namespace {
+
+template <typename T> bool laneInCardioidOrBulb(T cr, T ci) {
+    T crShifted = cr - T(0.25);
+    T q = crShifted * crShifted + ci * ci;
+    if (q * (q + crShifted) < T(0.25) * ci * ci) {
+        return true;
+    }
+    T crPlus1 = cr + T(1.0);
+    return crPlus1 * crPlus1 + ci * ci < T(0.0625);
+}
+
+template <typename Ops>
+void escapeTimeBatch(const double *crs,
+                     const double *cis,
+                     std::size_t count,
+                     int maxIterations,
+                     int *iterations,
+                     double *modulus2,
+                     EscapeState *states) {
+    using T = typename Ops::T;
+    using V = typename Ops::V;
+    using M = typename Ops::M;
+    constexpr std::size_t lanes = Ops::lanes;
+
+    // per lane state, spilled to memory only when a lane finishes or has a cycle to prove
+    alignas(64) T crBuf[lanes], ciBuf[lanes];
+    alignas(64) T zrBuf[lanes], ziBuf[lanes], zr2Buf[lanes], zi2Buf[lanes];
+    alignas(64) T zrOldBuf[lanes], ziOldBuf[lanes], dz2Buf[lanes];
+    alignas(64) T nBuf[lanes], nextCheckBuf[lanes], checkPeriodBuf[lanes], hintCheckBuf[lanes];
+    std::size_t point[lanes];
+    int hint[lanes];
+    unsigned liveBits = 0;
+    std::size_t next = 0;
+    // the period the point finished last was proven inside with, its neighbours try it first.
+    // Not with states: which point finishes last differs from the scalar loop
+    int lastPeriod = 0;
+    // tallied per batch, handed to the profiler once at the end
+    std::uint64_t bulbSkips = 0, periodicExits = 0, iterationsDone = 0;
+    std::uint64_t hintedExits = 0, proofIterations = 0, savedIterations = 0;
+
+    // points with a state go on from it, they are known to be outside the bulbs
+    auto resumes = [&](std::size_t i) { return states && states[i].n > 0; };
+    auto refill = [&](std::size_t l) {
+        while (next < count && !resumes(next) &&
+               laneInCardioidOrBulb(static_cast<T>(crs[next]), static_cast<T>(cis[next]))) {
+            iterations[next] = -1;
+            modulus2[next] = 0.0;
+            next++;
+            bulbSkips++;
+        }
+        crBuf[l] = ciBuf[l] = T(0.0);
+        zrBuf[l] = ziBuf[l] = zr2Buf[l] = zi2Buf[l] = zrOldBuf[l] = ziOldBuf[l] = T(0.0);
+        nBuf[l] = T(0.0);
+        nextCheckBuf[l] = checkPeriodBuf[l] = static_cast<T>(FIRST_CYCLE_CHECK);
+        dz2Buf[l] = T(1.0);
+        hint[l] = states ? 0 : lastPeriod;
+        hintCheckBuf[l] = T(0.0);
+        if (hint[l] > 0) {
+            int at = 1;
+            while (at < 2 * hint[l]) {
+                at *= 2;
+            }
+            // no need to stop there if the proof would not pay
+            if (hint[l] * CYCLE_PROOF_COST < maxIterations - at) {
+                hintCheckBuf[l] = static_cast<T>(at);
+            }
+        }
+        if (next < count && resumes(next)) {
+            EscapeState const &state = states[next];
+            zrBuf[l] = static_cast<T>(state.zr);
+            ziBuf[l] = static_cast<T>(state.zi);
+            zr2Buf[l] = zrBuf[l] * zrBuf[l];
+            zi2Buf[l] = ziBuf[l] * ziBuf[l];
+            zrOldBuf[l] = static_cast<T>(state.zrOld);
+            ziOldBuf[l] = static_cast<T>(state.ziOld);
+            dz2Buf[l] = static_cast<T>(state.dz2);
+            nBuf[l] = static_cast<T>(state.n);
+            nextCheckBuf[l] = static_cast<T>(state.nextCheck);
+            checkPeriodBuf[l] = static_cast<T>(state.checkPeriod);
+            iterationsDone -= state.n;
+        }
+        if (next < count) {
+            point[l] = next;
+            crBuf[l] = static_cast<T>(crs[next]);
+            ciBuf[l] = static_cast<T>(cis[next]);
+            liveBits |= 1u << l;
+            next++;
+        } else {
+            liveBits &= ~(1u << l);
+        }
+    };
+    for (std::size_t l = 0; l < lanes; l++) {
+        refill(l);
+    }
+
+    const V one = Ops::set1(T(1.0));
+    const V two = Ops::set1(T(2.0));
+    const V four = Ops::set1(T(4.0));
+    const V cycleTolerance = Ops::set1(PrecisionTraits<T>::CYCLE_TOLERANCE);
+    const V derivativeFloor = Ops::set1(PrecisionTraits<T>::DERIVATIVE_FLOOR);
+    const V limit = Ops::set1(static_cast<T>(maxIterations));
+    const T notANumber = std::numeric_limits<T>::quiet_NaN();
+
+    V cr = Ops::load(crBuf), ci = Ops::load(ciBuf);
+    V zr = Ops::load(zrBuf), zi = Ops::load(ziBuf);
+    V zr2 = Ops::load(zr2Buf), zi2 = Ops::load(zi2Buf);
+    V zrOld = Ops::load(zrOldBuf), ziOld = Ops::load(ziOldBuf), dz2 = Ops::load(dz2Buf);
+    V n = Ops::load(nBuf), nextCheck = Ops::load(nextCheckBuf);
+    V checkPeriod = Ops::load(checkPeriodBuf), hintCheck = Ops::load(hintCheckBuf);
+    V zModulus2 = Ops::add(zr2, zi2);
+    const M none = Ops::cmpLt(one, one);
+
+    while (liveBits != 0) {
+        dz2 = Ops::max(Ops::mul(dz2, Ops::mul(four, zModulus2)), derivativeFloor);
+        zi = Ops::add(Ops::mul(Ops::mul(two, zr), zi), ci);
+        zr = Ops::add(Ops::sub(zr2, zi2), cr);
+        zr2 = Ops::mul(zr, zr);
+        zi2 = Ops::mul(zi, zi);
+        zModulus2 = Ops::add(zr2, zi2);
+        n = Ops::add(n, one);
+
+        // back near the saved z where the orbit contracts, except where it was saved just now.
+        // Without a branch, which lanes contract changes too often to predict, and on the real
+        // part alone: the lane checks the distance before it tries anything
+        V diffR = Ops::sub(zr, zrOld);
+        M due = Ops::cmpEq(n, nextCheck);
+        M cycle = Ops::maskAndNot(
+            due,
+            Ops::maskAnd(Ops::cmpLt(dz2, one), Ops::cmpLt(Ops::mul(diffR, diffR), cycleTolerance)));
+        M hinted = none;
+        if (Ops::any(due)) {
+            hinted = Ops::maskAnd(due, Ops::cmpEq(n, hintCheck));
+            zrOld = Ops::select(due, zrOld, zr);
+            ziOld = Ops::select(due, ziOld, zi);
+            dz2 = Ops::select(due, dz2, one);
+            nextCheck = Ops::select(due, nextCheck, Ops::add(nextCheck, checkPeriod));
+            checkPeriod = Ops::select(due, checkPeriod, Ops::mul(checkPeriod, two));
+        }
+
+        M escaped = Ops::maskNot(Ops::cmpLe(zModulus2, four));
+        M done = Ops::maskOr(Ops::maskOr(Ops::maskOr(cycle, hinted), escaped),
+                             Ops::cmpEq(n, limit));
+        unsigned doneBits = Ops::bits(done) & liveBits;
+        if (doneBits == 0) {
+            continue;
+        }
+
+        Ops::store(crBuf, cr), Ops::store(ciBuf, ci);
+        Ops::store(zrBuf, zr), Ops::store(ziBuf, zi);
+        Ops::store(zr2Buf, zr2), Ops::store(zi2Buf, zi2);
+        Ops::store(zrOldBuf, zrOld), Ops::store(ziOldBuf, ziOld), Ops::store(dz2Buf, dz2);
+        Ops::store(nBuf, n), Ops::store(nextCheckBuf, nextCheck);
+        Ops::store(checkPeriodBuf, checkPeriod), Ops::store(hintCheckBuf, hintCheck);
+        unsigned cycleBits = Ops::bits(cycle);
+        unsigned hintedBits = Ops::bits(hinted);
+        unsigned escapedBits = Ops::bits(escaped);
+        for (std::size_t l = 0; l < lanes; l++) {
+            if (!((doneBits >> l) & 1u)) {
+                continue;
+            }
+            int laneIterations = static_cast<int>(nBuf[l]);
+            // the same proofs as escapeTime(), out of line, on the state after the save
+            int proven = 0;
+            if ((hintedBits >> l) & 1u) {
+                if (attractingCycleOutOfLine(
+                        crBuf[l], ciBuf[l], zrBuf[l], ziBuf[l], hint[l], proofIterations)) {
+                    proven = hint[l];
+                    hintedExits++;
+                }
+            } else if ((cycleBits >> l) & 1u) {
+                int period = laneIterations -
+                             (static_cast<int>(nextCheckBuf[l]) -
+                              static_cast<int>(checkPeriodBuf[l]) / 2);
+                T diffR = zrBuf[l] - zrOldBuf[l];
+                T diffI = ziBuf[l] - ziOldBuf[l];
+                T distance2 = diffR * diffR + diffI * diffI;
+                if (distance2 < PrecisionTraits<T>::CYCLE_TOLERANCE) {
+                    if (distance2 < PrecisionTraits<T>::PERIOD_TOLERANCE ||
+                        (period * CYCLE_PROOF_COST < maxIterations - laneIterations &&
+                         attractingCycleOutOfLine(
+                             crBuf[l], ciBuf[l], zrBuf[l], ziBuf[l], period, proofIterations))) {
+                        proven = period;
+                    } else {
+                        zrOldBuf[l] = ziOldBuf[l] = notANumber;
+                    }
+                }
+            }
+            bool escapedLane = (escapedBits >> l) & 1u;
+            if (!proven && !escapedLane && laneIterations < maxIterations) {
+                continue; // no cycle after all, iterates on
+            }
+            bool inside = proven || laneIterations == maxIterations;
+            iterations[point[l]] = inside ? -1 : laneIterations;
+            modulus2[point[l]] = static_cast<double>(zr2Buf[l] + zi2Buf[l]);
+            if (states && !proven && laneIterations == maxIterations) {
+                states[point[l]] = {static_cast<double>(zrBuf[l]),
+                                    static_cast<double>(ziBuf[l]),
+                                    static_cast<double>(zrOldBuf[l]),
+                                    static_cast<double>(ziOldBuf[l]),
+                                    laneIterations,
+                                    static_cast<int>(nextCheckBuf[l]),
+                                    static_cast<int>(checkPeriodBuf[l]),
+                                    0,
+                                    true,
+                                    static_cast<double>(dz2Buf[l])};
+            }
+            if (proven) {
+                periodicExits++;
+                savedIterations += maxIterations - laneIterations;
+            }
+            lastPeriod = proven;
+            iterationsDone += laneIterations;
+            refill(l);
+        }
+        cr = Ops::load(crBuf), ci = Ops::load(ciBuf);
+        zr = Ops::load(zrBuf), zi = Ops::load(ziBuf);
+        zr2 = Ops::load(zr2Buf), zi2 = Ops::load(zi2Buf);
+        zrOld = Ops::load(zrOldBuf), ziOld = Ops::load(ziOldBuf), dz2 = Ops::load(dz2Buf);
+        n = Ops::load(nBuf), nextCheck = Ops::load(nextCheckBuf);
+        checkPeriod = Ops::load(checkPeriodBuf), hintCheck = Ops::load(hintCheckBuf);
+        zModulus2 = Ops::add(zr2, zi2);
+    }
+    PROFILE_COUNT(BulbSkips, bulbSkips);
+    PROFILE_COUNT(PeriodicExits, periodicExits);
+    PROFILE_COUNT(HintedExits, hintedExits);
+    PROFILE_COUNT(Iterations, iterationsDone);
+    PROFILE_COUNT(ProofIterations, proofIterations);
+    PROFILE_COUNT(SavedIterations, savedIterations);
+}
+
+} // namespace
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <TileStore.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* tile of TILE_SIZE x TILE_SIZE samples on the global lattice of one quantized zoom level,
+ * sample (gx, gy) sits at c = (gx dx, -gy dy) */
+struct TileKey {
+    std::int64_t levelX, levelY; // quantized log2 of the sample spacing
+    std::int64_t tileX, tileY;
+    std::uint64_t params; // hash of everything else the samples depend on
+
+    bool operator==(TileKey const &other) const {
+        return levelX == other.levelX && levelY == other.levelY && tileX == other.tileX &&
+               tileY == other.tileY && params == other.params;
+    }
+};
+
+struct TileKeyHash {
+    std::size_t operator()(TileKey const &key) const;
+};
+
+/* memory bounded LRU cache of iteration tiles, NaN marks samples never computed.
+ * Evicted tiles go to the optional on-disk store and come back from there on a miss */
+class TileCache {
+public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr std::size_t TILE_SAMPLES = TILE_SIZE * TILE_SIZE;
+    using Tile = std::vector<double>;
+
+    /* spillDirectory empty for memory only, spillBytes bounds the file there */
+    TileCache(std::size_t budgetBytes, std::string const &spillDirectory, std::size_t spillBytes);
+
+    /* copies the tile into out, false on a miss */
+    bool find(TileKey const &key, Tile &out);
+
+    /* merges into what is cached already: samples NaN in tile keep their cached value */
+    void insert(TileKey const &key, Tile const &tile);
+
+    std::size_t sizeBytes() const;
+
+private:
+    using LruList = std::list<std::pair<TileKey, Tile>>;
+
+    void evictOverBudget();
+
+    std::size_t budgetBytes;
+    LruList lru; // most recently used first
+    std::unordered_map<TileKey, LruList::iterator, TileKeyHash> index;
+    std::unique_ptr<TileStore> store;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ConfigLoader.hpp>
+#include <Viewport.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* messages between fractal_cluster and its fractal_worker processes, over anything that
+ * carries bytes in order: a socket to a local worker, the pipes of an ssh to another node.
+ * Little endian whatever the host, so nodes of any kind can mix */
+namespace tileprotocol {
+
+enum class MessageType : std::uint8_t { Job = 1, Result = 2, Error = 3 };
+
+/* pixels x0 <= x < x1, y0 <= y < y1 of a width x height render of viewport */
+struct Job {
+    std::uint32_t id = 0;
+    ConfigLoader::FractalParams fractal; // what changes the iterated values is sent
+    Viewport viewport{};
+    std::uint32_t width = 0, height = 0;
+    std::uint32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+};
+
+/* the iteration field of a job's pixels, row major */
+struct Result {
+    std::uint32_t id = 0;
+    std::vector<float> field;
+};
+
+struct Message {
+    MessageType type = MessageType::Error;
+    std::vector<std::uint8_t> payload;
+};
+
+/* decoding throws std::runtime_error on a malformed payload */
+std::vector<std::uint8_t> encodeJob(Job const &job);
+Job decodeJob(std::vector<std::uint8_t> const &payload);
+
+/* the field goes byte-shuffled, its exponent bytes deflated */
+std::vector<std::uint8_t> encodeResult(Result const &result);
+Result decodeResult(std::vector<std::uint8_t> const &payload);
+
+std::vector<std::uint8_t> encodeError(std::uint32_t id, std::string const &what);
+void decodeError(std::vector<std::uint8_t> const &payload, std::uint32_t &id, std::string &what);
+
+/* false at the end of the stream before a message, throws std::runtime_error if the stream
+ * breaks or ends inside one */
+bool readMessage(int fd, Message &message);
+/* throws std::runtime_error if the other end is gone, never raises SIGPIPE on a socket */
+void writeMessage(int fd, MessageType type, std::vector<std::uint8_t> const &payload);
+
+} // namespace tileprotocol
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/* splits a frame into square tiles and runs them on all OpenMP threads with work stealing.
+ * Every worker owns a contiguous share of the tiles in Morton order, about equal in estimated
+ * cost, works through it most expensive first and steals from the others once it runs dry */
+class TileScheduler {
+public:
+    /* half-open pixel bounds */
+    struct Tile {
+        std::size_t x0, y0, x1, y1;
+        double cost;
+    };
+
+    /* 32 x 32 iteration counts are 8 KB, a tile and its batch buffers stay in L1 */
+    static constexpr std::size_t TILE_SIZE = 32;
+
+    TileScheduler(std::size_t width, std::size_t height);
+    /* only the parts of the tiles inside these disjoint regions, their costs ignored. Work
+     * then grows with the regions, not the frame */
+    TileScheduler(std::size_t width, std::size_t height, std::vector<Tile> const &regions);
+
+    /* cost of every tile from what is left to compute: known pixels (not NaN) are free,
+     * the others cost their estimate, -1 (inside) the full budget and the mean if NaN */
+    void estimateCosts(std::vector<double> const &iterCounts,
+                       std::vector<double> const *estimate,
+                       int maxIterations);
+
+    /* calls work once per tile, concurrently, returns when all are done */
+    void run(std::function<void(Tile const &)> const &work);
+
+    /* busy time / wall time of every worker over all run() calls */
+    std::vector<double> utilization() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::size_t> tiles; // most expensive first, thieves take from the back
+        double busySeconds = 0.0;
+    };
+
+    void distribute(std::vector<Worker> &workers) const;
+    bool take(std::vector<Worker> &workers, std::size_t self, std::size_t &tile);
+
+    std::size_t width;
+    std::vector<Tile> tiles; // in Morton order
+    std::vector<double> busySeconds;
+    double wallSeconds = 0.0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+struct TileKey;
+
+/* append-only file of fixed size tile records, read back through mmap.
+ * Starts over once it grows past its byte budget */
+class TileStore {
+public:
+    TileStore(std::string const &directory, std::size_t samplesPerTile, std::size_t budgetBytes);
+    ~TileStore();
+
+    TileStore(TileStore const &) = delete;
+    TileStore &operator=(TileStore const &) = delete;
+
+    void write(TileKey const &key, double const *samples);
+
+    /* copies the stored samples out, false if the tile is not on disk */
+    bool read(TileKey const &key, double *samples);
+
+private:
+    void remap();
+    void reset();
+
+    int fd = -1;
+    std::string path;
+    std::size_t recordBytes;
+    std::size_t budgetBytes;
+    std::size_t fileBytes = 0;
+    void *mapping = nullptr;
+    std::size_t mappedBytes = 0;
+    std::unordered_map<std::uint64_t, std::size_t> offsets; // key hash -> record offset
+};
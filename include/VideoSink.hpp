@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* where the frames of a video go, one RGBA frame of the size given to open() at a time */
+class VideoSink {
+public:
+    virtual ~VideoSink() = default;
+
+    virtual void writeFrame(std::uint8_t const *rgba) = 0;
+
+    /* flushes what is buffered, throws std::runtime_error on failure like writeFrame */
+    virtual void finish() = 0;
+
+    /* output ending in .y4m is a raw YUV4MPEG2 file, "-" the same on stdout for piping into
+     * an encoder, anything else a directory filled with frame_000000.png ... */
+    static std::unique_ptr<VideoSink>
+    open(std::string const &output, unsigned width, unsigned height, double fps);
+};
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <HighPrecision.hpp>
+
 struct Viewport {
-    double centerX; 
-    double centerY;
+    HPReal centerX; // high precision so deep zooms can still be panned
+    HPReal centerY;
     double width;  // range real
     double height; // range imaginary
-};
\ No newline at end of file
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <HighPrecision.hpp>
+#include <Viewport.hpp>
+
+#include <vector>
+
+struct Keyframe {
+    double time; // seconds
+    HPReal centerX, centerY;
+    double logZoom; // log2 of BASE_WIDTH / width
+};
+
+/* camera path through keyframes: log zoom linear in time, the center moving in proportion
+ * to how much the width has shrunk so a zoom into a point does not drift past it */
+class ZoomPath {
+public:
+    /* width at log zoom 0, the viewer's initial view */
+    static constexpr double BASE_WIDTH = 4.0;
+
+    /* throws std::invalid_argument without keyframes or with times not increasing */
+    explicit ZoomPath(std::vector<Keyframe> keyframes);
+
+    double startTime() const;
+    double duration() const;
+    double logZoomAt(double time) const;
+    /* aspect is height / width of the frame */
+    Viewport at(double time, double aspect) const;
+
+    /* true if the zoom keeps increasing, timeAtLogZoom() needs it */
+    bool zoomIncreasing() const;
+    double timeAtLogZoom(double logZoom) const;
+
+private:
+    std::size_t segmentAt(double time) const;
+
+    std::vector<Keyframe> keyframes;
+};
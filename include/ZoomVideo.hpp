@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <Colorizer.hpp>
+#include <FractalBase.hpp>
+#include <VideoSink.hpp>
+#include <ZoomPath.hpp>
+
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/* renders the frames of a zoom along a path into a sink, headless. A second thread colors
+ * and writes frame N while frame N + 1 is computed.
+ * Exact computes every frame, each reusing the samples of the one before that line up.
+ * Octave computes one key image per 2x zoom at twice the frame resolution and resamples the
+ * frames in between from the two keys around them, consecutive keys share a quarter of their
+ * samples. Needs a path that keeps zooming in */
+class ZoomVideo {
+public:
+    enum class Mode { Exact, Octave };
+
+    /* the fractal must not snap to a lattice (no tile cache), frames are mapped by viewport */
+    ZoomVideo(FractalBase &fractal, ZoomPath path, unsigned width, unsigned height, double fps);
+
+    std::size_t frameCount() const;
+
+    /* progress goes to log, throws what the sink throws and std::invalid_argument for an
+     * octave video of a path that zooms out */
+    void render(Mode mode, VideoSink &sink, std::ostream &log);
+
+private:
+    /* one computed image and where it sits, samples at left + x spacing, top - y spacing */
+    struct Key {
+        std::vector<float> field;
+        Viewport vp;
+        unsigned width, height;
+        double spacing;
+    };
+
+    void renderExact(VideoSink &sink, std::ostream &log);
+    void renderOctaves(VideoSink &sink, std::ostream &log);
+
+    std::shared_ptr<Key> computeKey(Viewport const &vp, unsigned width, unsigned height);
+    std::vector<float> resample(Key const &outer, Key const &inner, Viewport const &vp) const;
+    /* colors with the range smoothed over frames so it does not flicker, writer thread only */
+    void writeField(VideoSink &sink, std::vector<float> const &field);
+
+    double frameTime(std::size_t index) const;
+    Viewport frameViewport(std::size_t index) const;
+
+    FractalBase &fractal;
+    ZoomPath path;
+    unsigned width, height;
+    double fps;
+
+    Colorizer colorizer;
+    std::vector<std::uint8_t> pixels;
+    ColorRange shownRange;
+    bool hasShownRange = false;
+
+    /* fraction of the way to a new frame's own color range the shown range moves */
+    static constexpr double RANGE_SMOOTHING = 0.1;
+    /* jobs the writer may fall behind before compute waits for it */
+    static constexpr std::size_t PIPELINE_DEPTH = 2;
+};
@@ -1,12 +1,15 @@
 #include <cstdint>
 #include <filesystem>
+#include <iostream>
 #include <string>
 
 #include <SFML/Graphics.hpp>
 
 #include <ConfigLoader.hpp>
 #include <EventHandler.hpp>
-#include <Mandelbrot.hpp>
+#include <FractalFactory.hpp>
+#include <Profiler.hpp>
+#include <SimdKernel.hpp>
 #include <Timer.hpp>
 #include <Viewport.hpp>
 
@@ -27,6 +30,8 @@ int main() {
     std::string rootPath = std::filesystem::path(exeDir).parent_path().string();
     std::string configPath = rootPath + "/config.yaml";
     ConfigLoader config(configPath);
+    std::cout << "Escape-time kernel: " << SimdKernel::isaName(SimdKernel::detectIsa())
+              << std::endl;
 
     std::string windowTitle = "Fractal Explorer - " + config.fractalParams.name;
     sf::RenderWindow window(sf::VideoMode({config.windowParams.width, config.windowParams.height}),
@@ -43,19 +48,35 @@ int main() {
     sf::Texture texture(image->getSize());
     sf::Sprite sprite(texture);
 
-    std::unique_ptr<FractalBase> fractal;
-    if (config.fractalParams.name == "Mandelbrot") {
-        fractal = std::make_unique<Mandelbrot>(image, &viewport);
-    } else {
-        throw std::runtime_error("Unknown fractal: " + config.fractalParams.name);
-    }
-
-    timeFunction([&] { fractal->compute(); });
-    texture.update(*image);
-    sprite.setTexture(texture);
+    std::unique_ptr<FractalBase> fractal =
+        isDensityFractal(config.fractalParams.name)
+            ? makeDensityFractal(config.fractalParams, config.densityParams, image, &viewport)
+            : makeFractal(config.fractalParams, image, &viewport);
 
-    EventHandler eventHandler(window, sprite, std::move(fractal), image, texture, &viewport);
+    AntialiasParams posterAntialiasing;
+    posterAntialiasing.maxSamples = config.posterParams.antialiasSamples;
+    posterAntialiasing.budget = config.posterParams.antialiasBudget;
+    posterAntialiasing.tolerance = config.posterParams.antialiasTolerance;
+    QualityParams interactiveQuality;
+    interactiveQuality.frameBudget = config.interactionParams.frameBudgetMs / 1000.0;
+    interactiveQuality.minScale = config.interactionParams.minScale;
+    interactiveQuality.minIterationScale = config.interactionParams.minIterationScale;
+    EventHandler eventHandler(window,
+                              sprite,
+                              std::move(fractal),
+                              image,
+                              texture,
+                              &viewport,
+                              posterAntialiasing,
+                              interactiveQuality);
     eventHandler.run();
 
+    if (Profiler::enabled()) {
+        Profiler::report(std::cout);
+        if (Profiler::writeChromeTrace("fractal_trace.json")) {
+            std::cout << "Trace written to fractal_trace.json" << std::endl;
+        }
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "Antialiaser.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+// splitmix64, the jitter only depends on the pixel and the sample so renders repeat exactly
+std::uint64_t mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+double unitInterval(std::uint64_t bits) { return static_cast<double>(bits >> 11) * 0x1.0p-53; }
+
+// colors are averaged in linear light, averaging sRGB bytes darkens the edges
+std::array<double, 256> const &linearTable() {
+    static const std::array<double, 256> table = [] {
+        std::array<double, 256> t;
+        for (std::size_t i = 0; i < t.size(); i++) {
+            double c = i / 255.0;
+            t[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        }
+        return t;
+    }();
+    return table;
+}
+
+std::uint8_t toSrgb(double linear) {
+    double c = linear <= 0.0031308 ? 12.92 * linear : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+    return static_cast<std::uint8_t>(std::clamp(c, 0.0, 1.0) * 255.0 + 0.5);
+}
+
+} // namespace
+
+Antialiaser::Antialiaser(AntialiasParams params, std::size_t width, std::size_t height)
+    : params(params),
+      width(width),
+      height(height),
+      side(0) {
+    if (params.maxSamples == 0) {
+        return;
+    }
+    if (params.maxSamples != 4 && params.maxSamples != 16 && params.maxSamples != 64) {
+        throw std::invalid_argument("Anti-aliasing takes 4, 16 or 64 samples per pixel");
+    }
+    unsigned bits = 0;
+    while ((1u << bits) < params.maxSamples) {
+        bits++;
+    }
+    side = 1u << (bits / 2);
+    strata.resize(params.maxSamples);
+    for (unsigned i = 0; i < params.maxSamples; i++) {
+        unsigned morton = 0;
+        for (unsigned b = 0; b < bits; b++) {
+            morton |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        unsigned x = 0, y = 0;
+        for (unsigned b = 0; b < bits / 2; b++) {
+            x |= ((morton >> (2 * b)) & 1u) << b;
+            y |= ((morton >> (2 * b + 1)) & 1u) << b;
+        }
+        strata[i] = y * side + x;
+    }
+}
+
+AntialiasStats Antialiaser::resolve(std::vector<float> const &field,
+                                    std::uint8_t *rgba,
+                                    Colorizer &colorizer,
+                                    ColorRange range,
+                                    Sampler const &sampler) {
+    AntialiasStats stats;
+    if (params.maxSamples == 0) {
+        return stats;
+    }
+    PROFILE_SCOPE("antialias");
+    auto const &linear = linearTable();
+
+    std::vector<Pixel> active = findEdges(field, rgba);
+    stats.edgePixels = active.size();
+    for (Pixel &pixel : active) {
+        for (std::size_t c = 0; c < 3; c++) {
+            double v = linear[rgba[4 * pixel.idx + c]];
+            pixel.sum[c] = v;
+            pixel.sumSquares[c] = v * v;
+        }
+        pixel.samples = 1;
+    }
+
+    auto budget = static_cast<std::size_t>(params.budget * static_cast<double>(width * height));
+    bool firstRound = true;
+    while (!active.empty() && budget >= SAMPLES_PER_ROUND) {
+        // the budget goes to the strongest edges, then to the least settled pixels
+        std::size_t affordable = budget / SAMPLES_PER_ROUND;
+        if (active.size() > affordable) {
+            std::nth_element(active.begin(),
+                             active.begin() + affordable,
+                             active.end(),
+                             [](Pixel const &a, Pixel const &b) {
+                                 return a.priority > b.priority;
+                             });
+            active.resize(affordable);
+        }
+
+        // SAMPLES_PER_ROUND strata further along every pixel's sequence, jittered inside
+        std::size_t count = active.size() * SAMPLES_PER_ROUND;
+        std::vector<double> px(count), py(count), values(count);
+        for (std::size_t p = 0; p < active.size(); p++) {
+            Pixel const &pixel = active[p];
+            double x = static_cast<double>(pixel.idx % width);
+            double y = static_cast<double>(pixel.idx / width);
+            for (unsigned s = 0; s < SAMPLES_PER_ROUND; s++) {
+                unsigned i = pixel.samples - 1 + s;
+                unsigned stratum = strata[i];
+                std::uint64_t hash = mix((static_cast<std::uint64_t>(pixel.idx) << 8) | i);
+                double jx = unitInterval(hash);
+                double jy = unitInterval(mix(hash));
+                px[p * SAMPLES_PER_ROUND + s] = x - 0.5 + (stratum % side + jx) / side;
+                py[p * SAMPLES_PER_ROUND + s] = y - 0.5 + (stratum / side + jy) / side;
+            }
+        }
+        constexpr std::size_t CHUNK = 256;
+        std::size_t chunks = (count + CHUNK - 1) / CHUNK;
+#pragma omp parallel for schedule(dynamic)
+        for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+            std::size_t begin = chunk * CHUNK;
+            std::size_t n = std::min(CHUNK, count - begin);
+            sampler(px.data() + begin, py.data() + begin, n, values.data() + begin);
+        }
+        std::vector<float> sampleField(values.begin(), values.end());
+        std::vector<std::uint8_t> colors(4 * count);
+        colorizer.apply(sampleField.data(), count, range, colors.data());
+        budget -= count;
+        stats.samples += count;
+        if (firstRound) {
+            stats.pixels = active.size();
+            firstRound = false;
+        }
+
+        std::vector<Pixel> unsettled;
+        for (std::size_t p = 0; p < active.size(); p++) {
+            Pixel pixel = active[p];
+            for (unsigned s = 0; s < SAMPLES_PER_ROUND; s++) {
+                std::uint8_t const *color = &colors[4 * (p * SAMPLES_PER_ROUND + s)];
+                for (std::size_t c = 0; c < 3; c++) {
+                    double v = linear[color[c]];
+                    pixel.sum[c] += v;
+                    pixel.sumSquares[c] += v * v;
+                }
+            }
+            pixel.samples += SAMPLES_PER_ROUND;
+            for (std::size_t c = 0; c < 3; c++) {
+                rgba[4 * pixel.idx + c] = toSrgb(pixel.sum[c] / pixel.samples);
+            }
+            double error = standardError(pixel);
+            if (pixel.samples - 1 < params.maxSamples && error > params.tolerance) {
+                pixel.priority = error;
+                unsettled.push_back(pixel);
+            }
+        }
+        active.swap(unsettled);
+    }
+    return stats;
+}
+
+// pixels on the inside/outside boundary, or with a channel jumping against a neighbour
+std::vector<Antialiaser::Pixel> Antialiaser::findEdges(std::vector<float> const &field,
+                                                       std::uint8_t const *rgba) const {
+    std::vector<int> contrast(width * height, 0);
+#pragma omp parallel for schedule(static)
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            std::size_t idx = y * width + x;
+            bool inside = field[idx] < 0.0f;
+            int strongest = 0;
+            for (std::size_t ny = y > 0 ? y - 1 : 0; ny <= std::min(y + 1, height - 1); ny++) {
+                for (std::size_t nx = x > 0 ? x - 1 : 0; nx <= std::min(x + 1, width - 1); nx++) {
+                    std::size_t n = ny * width + nx;
+                    if ((field[n] < 0.0f) != inside) {
+                        strongest = 255;
+                        continue;
+                    }
+                    for (std::size_t c = 0; c < 3; c++) {
+                        int difference = std::abs(rgba[4 * n + c] - rgba[4 * idx + c]);
+                        strongest = std::max(strongest, difference);
+                    }
+                }
+            }
+            contrast[idx] = strongest;
+        }
+    }
+
+    std::vector<Pixel> edges;
+    for (std::size_t idx = 0; idx < contrast.size(); idx++) {
+        if (contrast[idx] > EDGE_CONTRAST) {
+            edges.push_back({idx, {}, {}, 0, static_cast<double>(contrast[idx])});
+        }
+    }
+    return edges;
+}
+
+// of the mean color, the largest over the channels
+double Antialiaser::standardError(Pixel const &pixel) const {
+    double n = pixel.samples;
+    double error = 0.0;
+    for (std::size_t c = 0; c < 3; c++) {
+        double variance = (pixel.sumSquares[c] - pixel.sum[c] * pixel.sum[c] / n) / (n - 1.0);
+        error = std::max(error, std::sqrt(std::max(variance, 0.0) / n));
+    }
+    return error;
+}
@@ -0,0 +1,320 @@
+#include "AsyncRenderer.hpp"
+
+#include "Profiler.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+AsyncRenderer::AsyncRenderer(FractalBase &fractal, sf::Image *renderImage, QualityParams quality)
+    : fractal(fractal),
+      renderImage(renderImage),
+      shownImage(renderImage),
+      quality(quality),
+      frontImage(renderImage->getSize()),
+      worker([this] { renderLoop(); }) {}
+
+AsyncRenderer::~AsyncRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        stopping = true;
+        fractal.requestCancel();
+    }
+    requestCv.notify_one();
+    worker.join();
+}
+
+void AsyncRenderer::request(Viewport const &viewport) { submit(viewport, {QualityLevel{}}); }
+
+void AsyncRenderer::requestInteractive(Viewport const &viewport) {
+    QualityLevel level;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        level = quality.interactive();
+        interactiveLevel = level;
+    }
+    submit(viewport, {level});
+}
+
+void AsyncRenderer::refine() {
+    Viewport viewport;
+    std::vector<QualityLevel> levels;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        levels = quality.refinement(interactiveLevel);
+        viewport = lastRequestedVp;
+        interactiveLevel = QualityLevel{};
+    }
+    if (!levels.empty()) {
+        submit(viewport, std::move(levels));
+    }
+}
+
+QualityController AsyncRenderer::qualityController() const {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    return quality;
+}
+
+QualityLevel AsyncRenderer::lastInteractiveLevel() const {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    return interactiveLevel;
+}
+
+void AsyncRenderer::submit(Viewport const &viewport, std::vector<QualityLevel> levels) {
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        pendingVp = viewport;
+        pendingLevels = std::move(levels);
+        lastRequestedVp = viewport;
+        hasPending = true;
+        fractal.requestCancel();
+    }
+    requestCv.notify_one();
+}
+
+bool AsyncRenderer::uploadIfReady(sf::Texture &texture, sf::Sprite &sprite) {
+    PROFILE_SCOPE("texture upload");
+    std::lock_guard<std::mutex> lock(frameMutex);
+    if (!frameReady) {
+        return false;
+    }
+    auto size = frontImage.getSize();
+    if (uploadFull || texture.getSize() != size) {
+        texture.update(frontImage);
+        textureOrigin = {0, 0};
+    } else {
+        // the texels stay where they are, the ring's origin follows the pan
+        auto wrap = [](int value, unsigned count) {
+            int n = static_cast<int>(count);
+            return (value % n + n) % n;
+        };
+        textureOrigin = {wrap(textureOrigin.x + uploadShift.x, size.x),
+                         wrap(textureOrigin.y + uploadShift.y, size.y)};
+        for (sf::IntRect const &rect : uploadRects) {
+            uploadRect(texture, rect);
+        }
+    }
+    texture.setRepeated(true);
+    sprite.setTextureRect({textureOrigin, sf::Vector2i(size)});
+    uploadFull = false;
+    uploadShift = {};
+    uploadRects.clear();
+    frameReady = false;
+    return true;
+}
+
+void AsyncRenderer::uploadRect(sf::Texture &texture, sf::IntRect rect) {
+    sf::Vector2i size(frontImage.getSize());
+    std::uint8_t const *pixels = frontImage.getPixelsPtr();
+    // pixel x sits at texel origin + x, wrapping around from pixel size - origin on
+    int splitX = size.x - textureOrigin.x;
+    int splitY = size.y - textureOrigin.y;
+    int x1 = rect.position.x + rect.size.x;
+    int y1 = rect.position.y + rect.size.y;
+    int xs[3] = {rect.position.x, std::clamp(splitX, rect.position.x, x1), x1};
+    int ys[3] = {rect.position.y, std::clamp(splitY, rect.position.y, y1), y1};
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+            int width = xs[i + 1] - xs[i];
+            int height = ys[j + 1] - ys[j];
+            if (width <= 0 || height <= 0) {
+                continue;
+            }
+            uploadBuffer.resize(4 * std::size_t(width) * height);
+            for (int y = 0; y < height; y++) {
+                std::memcpy(&uploadBuffer[4 * std::size_t(y) * width],
+                            pixels + 4 * (std::size_t(ys[j] + y) * size.x + xs[i]),
+                            4 * std::size_t(width));
+            }
+            sf::Vector2u dest((xs[i] + textureOrigin.x) % size.x,
+                              (ys[j] + textureOrigin.y) % size.y);
+            texture.update(uploadBuffer.data(),
+                           {static_cast<unsigned>(width), static_cast<unsigned>(height)},
+                           dest);
+        }
+    }
+}
+
+void AsyncRenderer::requestRecolor(std::function<void(FractalBase &)> change) {
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        pendingChanges.push_back(std::move(change));
+    }
+    requestCv.notify_one();
+}
+
+void AsyncRenderer::requestChange(std::function<void(FractalBase &)> change) {
+    Viewport viewport;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        pendingChanges.push_back(std::move(change));
+        viewport = lastRequestedVp;
+    }
+    request(viewport);
+}
+
+void AsyncRenderer::runExclusive(std::function<void()> const &func) {
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        fractal.requestCancel();
+    }
+    {
+        std::lock_guard<std::mutex> computeLock(computeMutex);
+        fractal.clearCancel();
+        // an interactive frame may have left the iterations lowered
+        fractal.setIterationScale(1.0);
+        func();
+        // func may have computed other frames, the next one can not move the shown one
+        frontIsLastFrame = false;
+    }
+    // the cancelled frame may have been the latest one, overlap reuse makes a repeat cheap
+    Viewport viewport;
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        viewport = lastRequestedVp;
+    }
+    request(viewport);
+}
+
+void AsyncRenderer::renderLoop() {
+    while (true) {
+        std::vector<std::function<void(FractalBase &)>> changes;
+        std::vector<QualityLevel> levels;
+        bool recolorOnly = false;
+        {
+            std::unique_lock<std::mutex> lock(requestMutex);
+            requestCv.wait(lock,
+                           [this] { return hasPending || !pendingChanges.empty() || stopping; });
+            if (stopping) {
+                return;
+            }
+            changes.swap(pendingChanges);
+            recolorOnly = !hasPending;
+            renderVp = hasPending ? pendingVp : renderVp;
+            levels.swap(pendingLevels);
+            hasPending = false;
+            // under requestMutex, so a request() from now on cancels this frame
+            fractal.clearCancel();
+        }
+
+        std::lock_guard<std::mutex> computeLock(computeMutex);
+        for (auto const &change : changes) {
+            change(fractal);
+        }
+        if (recolorOnly) {
+            // into the image and viewport of the last frame, a scaled one has its own
+            fractal.setTarget(shownImage, &frameVp);
+            fractal.recolor();
+            publish();
+            frontIsLastFrame = false;
+            continue;
+        }
+        // a plain request shows its coarse passes, a refinement keeps the previous pass up
+        // until the next one is done, its own first passes would be coarser
+        bool progressive = levels.size() == 1 && levels.front().full();
+        for (QualityLevel level : levels) {
+            if (fractal.cancelRequested()) {
+                break;
+            }
+            renderLevel(level, progressive);
+        }
+    }
+}
+
+void AsyncRenderer::renderLevel(QualityLevel level, bool progressive) {
+    auto start = std::chrono::steady_clock::now();
+    frameVp = renderVp;
+    shownImage = renderImage;
+    shownScale = level.scale;
+    if (level.scale < 1.0) {
+        // pixel (x, y) of the scaled frame samples pixel (x / scale, y / scale) of the full one,
+        // so the next pass reuses it. The frame may reach past the window by a pixel
+        auto size = renderImage->getSize();
+        sf::Vector2u scaledSize{static_cast<unsigned>(std::ceil(size.x * level.scale)),
+                                static_cast<unsigned>(std::ceil(size.y * level.scale))};
+        if (scaledImage.getSize() != scaledSize) {
+            scaledImage.resize(scaledSize);
+        }
+        frameVp.width = renderVp.width * scaledSize.x / (size.x * level.scale);
+        frameVp.height = renderVp.height * scaledSize.y / (size.y * level.scale);
+        frameVp.centerX += 0.5 * (frameVp.width - renderVp.width);
+        frameVp.centerY -= 0.5 * (frameVp.height - renderVp.height);
+        shownImage = &scaledImage;
+    }
+    fractal.setIterationScale(level.iterationScale);
+    fractal.setTarget(shownImage, &frameVp);
+    // a pan only changes part of the frame the front image shows, as long as it is that one
+    bool frontIsPrevious = frontIsLastFrame;
+    frontIsLastFrame = false;
+    if (progressive) {
+        fractal.setProgressCallback([this, &frontIsPrevious] {
+            frontIsPrevious = false;
+            publish();
+        });
+    }
+    timeFunction([&] { fractal.compute(); });
+    fractal.setProgressCallback({});
+    if (fractal.cancelRequested()) {
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(requestMutex);
+        quality.recordCancelled(level, seconds);
+        return;
+    }
+    publish(frontIsPrevious ? &fractal.lastImageUpdate() : nullptr);
+    frontIsLastFrame = shownImage == renderImage;
+
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(requestMutex);
+    quality.record(level, seconds);
+}
+
+void AsyncRenderer::publish(ImageUpdate const *update) {
+    PROFILE_SCOPE("publish");
+    auto size = frontImage.getSize();
+    auto shownSize = shownImage->getSize();
+    if (shownSize == size) {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        frontImage = *shownImage;
+        frameReady = true;
+        if (!update || !update->partial) {
+            uploadFull = true;
+            return;
+        }
+        // rects still to upload move along with the image
+        sf::Vector2i bounds(size);
+        std::vector<sf::IntRect> rects;
+        for (sf::IntRect rect : uploadRects) {
+            int x0 = std::max(rect.position.x - update->shift.x, 0);
+            int y0 = std::max(rect.position.y - update->shift.y, 0);
+            int x1 = std::min(rect.position.x + rect.size.x - update->shift.x, bounds.x);
+            int y1 = std::min(rect.position.y + rect.size.y - update->shift.y, bounds.y);
+            if (x0 < x1 && y0 < y1) {
+                rects.push_back({{x0, y0}, {x1 - x0, y1 - y0}});
+            }
+        }
+        rects.insert(rects.end(), update->rects.begin(), update->rects.end());
+        uploadRects = std::move(rects);
+        uploadShift.x += update->shift.x;
+        uploadShift.y += update->shift.y;
+        uploadFull = uploadFull || uploadRects.size() > MAX_UPLOAD_RECTS;
+        return;
+    }
+    // nearest neighbour, pixel (x, y) of the window shows the sample at or before it
+    std::uint8_t const *src = shownImage->getPixelsPtr();
+    upscaled.resize(4 * std::size_t(size.x) * size.y);
+    for (unsigned y = 0; y < size.y; y++) {
+        std::size_t srcRow = std::min<std::size_t>(y * shownScale, shownSize.y - 1) * shownSize.x;
+        for (unsigned x = 0; x < size.x; x++) {
+            std::size_t srcIdx = srcRow + std::min<std::size_t>(x * shownScale, shownSize.x - 1);
+            std::memcpy(&upscaled[4 * (std::size_t(y) * size.x + x)], src + 4 * srcIdx, 4);
+        }
+    }
+    std::lock_guard<std::mutex> lock(frameMutex);
+    frontImage.resize(size, upscaled.data());
+    frameReady = true;
+    uploadFull = true;
+}
@@ -0,0 +1,135 @@
+#include "BatchRenderer.hpp"
+
+#include "FractalFactory.hpp"
+#include "PngStreamWriter.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+#include <omp.h>
+
+namespace {
+
+// everything but the iteration limit, which is set per job
+bool sameFormula(ConfigLoader::FractalParams const &a, ConfigLoader::FractalParams const &b) {
+    return a.name == b.name && a.power == b.power && a.juliaCr == b.juliaCr &&
+           a.juliaCi == b.juliaCi && a.subdivision == b.subdivision &&
+           a.subdivisionGuard == b.subdivisionGuard &&
+           a.doubleDoubleDeepZoom == b.doubleDoubleDeepZoom &&
+           a.iterationsPerZoomDecade == b.iterationsPerZoomDecade &&
+           a.iterationDeepening == b.iterationDeepening &&
+           a.distanceEstimation == b.distanceEstimation &&
+           a.distanceSkipping == b.distanceSkipping &&
+           a.distanceValidation == b.distanceValidation;
+}
+
+std::size_t jobPixels(ConfigLoader::BatchParams::Job const &job) {
+    return std::size_t(job.width) * job.height;
+}
+
+} // namespace
+
+BatchRenderer::BatchRenderer(std::size_t smallJobPixels) : smallJobPixels(smallJobPixels) {}
+
+std::vector<BatchRenderer::Result>
+BatchRenderer::render(std::vector<ConfigLoader::BatchParams::Job> const &jobs,
+                      std::ostream &log) {
+    std::vector<Result> results(jobs.size());
+    std::vector<std::size_t> small, large;
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        (jobPixels(jobs[i]) <= smallJobPixels ? small : large).push_back(i);
+    }
+    // most expensive first so the last ones to finish are short
+    std::stable_sort(small.begin(), small.end(), [&](std::size_t a, std::size_t b) {
+        return double(jobPixels(jobs[a])) * jobs[a].fractal.maxIterations >
+               double(jobPixels(jobs[b])) * jobs[b].fractal.maxIterations;
+    });
+
+    slots.resize(std::max<std::size_t>(slots.size(), omp_get_max_threads()));
+    auto report = [&](std::size_t index) {
+        if (!results[index].error.empty()) {
+#pragma omp critical(batch_log)
+            log << jobs[index].output << ": " << results[index].error << std::endl;
+        }
+    };
+
+    for (std::size_t index : large) {
+        results[index] = renderJob(slots[0], jobs[index]);
+        report(index);
+    }
+
+    // the compute() of a small job runs on its own thread alone, the scheduler's team is 1
+    int activeLevels = omp_get_max_active_levels();
+    omp_set_max_active_levels(1);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(static_cast<int>(slots.size()))
+    for (std::size_t i = 0; i < small.size(); i++) {
+        Slot &slot = slots[static_cast<std::size_t>(omp_get_thread_num())];
+        results[small[i]] = renderJob(slot, jobs[small[i]]);
+        report(small[i]);
+    }
+    omp_set_max_active_levels(activeLevels);
+    return results;
+}
+
+BatchRenderer::Result BatchRenderer::renderJob(Slot &slot,
+                                               ConfigLoader::BatchParams::Job const &job) {
+    PROFILE_SCOPE("batch job");
+    Result result;
+    result.pixels = jobPixels(job);
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (job.width == 0 || job.height == 0) {
+            throw std::runtime_error("Empty image size");
+        }
+        EscapeTimeFractal &fractal = fractalFor(slot, job.fractal);
+        fractal.setIterationLimit(job.fractal.maxIterations);
+        // the image is replaced by the fractal's pixels, only its size matters
+        if (slot.image.getSize() != sf::Vector2u{job.width, job.height}) {
+            slot.image.resize({job.width, job.height});
+        }
+        slot.viewport = {HPReal(job.centerX),
+                         HPReal(job.centerY),
+                         job.viewWidth,
+                         job.viewWidth * job.height / job.width};
+        // a neighbouring job could be taken as a pan and keep the colors of the one before
+        fractal.forgetPreviousFrame();
+        fractal.setTarget(&slot.image, &slot.viewport);
+        fractal.compute();
+
+        std::filesystem::path parent = std::filesystem::path(job.output).parent_path();
+        if (!parent.empty()) {
+            std::error_code ignored; // another thread may create it too, the writer reports
+            std::filesystem::create_directories(parent, ignored);
+        }
+        PngStreamWriter writer(job.output, job.width, job.height);
+        writer.writeRows(slot.image.getPixelsPtr(), job.height);
+        writer.finish();
+    } catch (std::exception const &e) {
+        result.error = e.what();
+    }
+    result.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    return result;
+}
+
+EscapeTimeFractal &BatchRenderer::fractalFor(Slot &slot,
+                                             ConfigLoader::FractalParams const &params) {
+    if (slot.fractal && sameFormula(slot.params, params)) {
+        return *slot.fractal;
+    }
+    if (isDensityFractal(params.name)) {
+        throw std::runtime_error("Density fractals are not rendered in batches: " + params.name);
+    }
+    // thousands of distinct views share no tiles, the cache would only take memory
+    ConfigLoader::FractalParams uncached = params;
+    uncached.tileCacheMB = 0;
+    slot.fractal = makeFractal(uncached, &slot.image, &slot.viewport);
+    slot.params = params;
+    return *slot.fractal;
+}
@@ -0,0 +1,416 @@
+#include "Buddhabrot.hpp"
+
+#include "EscapeTime.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <omp.h>
+
+namespace {
+
+constexpr char CHECKPOINT_MAGIC[8] = {'F', 'R', 'C', 'T', 'D', 'E', 'N', 'S'};
+constexpr std::uint32_t CHECKPOINT_VERSION = 1;
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* checkpoint file start in the host's byte order, followed by the limits, the histogram and
+ * the cell statistics */
+struct CheckpointHeader {
+    char magic[8];
+    std::uint32_t byteOrder;
+    std::uint32_t version;
+    std::uint32_t width, height, channels, grid;
+    double left, top, dx, dy;
+    std::uint64_t samples;
+};
+
+template <typename T> void writeArray(std::ofstream &out, std::vector<T> const &values) {
+    out.write(reinterpret_cast<char const *>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template <typename T> void readArray(std::ifstream &in, std::vector<T> &values) {
+    in.read(reinterpret_cast<char *>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+} // namespace
+
+bool Buddhabrot::Frame::operator==(Frame const &other) const {
+    return width == other.width && height == other.height && left == other.left &&
+           top == other.top && dx == other.dx && dy == other.dy;
+}
+
+Buddhabrot::Buddhabrot(sf::Image *image, Viewport *vp, DensityParams params)
+    : FractalBase(image, vp),
+      params(std::move(params)),
+      maxLimit(*std::max_element(this->params.limits.begin(), this->params.limits.end())),
+      channels(this->params.limits.size()),
+      threads(static_cast<std::size_t>(omp_get_max_threads())) {
+    // a checkpoint must not see the same samples again
+    std::random_device seed;
+    for (ThreadState &thread : threads) {
+        thread.rng.seed((std::uint64_t(seed()) << 32) ^ seed());
+        thread.zr.resize(maxLimit);
+        thread.zi.resize(maxLimit);
+        thread.cellHits.assign(GRID * GRID, 0.0);
+        thread.cellSamples.assign(GRID * GRID, 0.0);
+    }
+}
+
+void Buddhabrot::compute() {
+    PROFILE_SCOPE("buddhabrot");
+    auto size = image->getSize();
+    Frame next;
+    next.width = size.x;
+    next.height = size.y;
+    next.dx = vp->width / size.x;
+    next.dy = vp->height / size.y;
+    next.left = static_cast<double>(vp->centerX) - 0.5 * vp->width;
+    next.top = static_cast<double>(vp->centerY) + 0.5 * vp->height;
+    if (!frameValid || !(next == frame)) {
+        frame = next;
+        frameValid = true;
+        histogram.assign(std::size_t(frame.width) * frame.height * channels, 0.0);
+        totalSamples = 0;
+        cellHits.assign(GRID * GRID, 0.0);
+        cellSamples.assign(GRID * GRID, 0.0);
+        for (ThreadState &thread : threads) {
+            thread.histogram.assign(histogram.size(), 0.0f);
+        }
+        if (loadCheckpoint()) {
+            std::cout << "Buddhabrot: carrying on from " << params.checkpointPath << " at "
+                      << totalSamples << " samples" << std::endl;
+        }
+    }
+    if (prior.empty()) {
+        buildPrior();
+    }
+    frameStats = {};
+    frameStats.pixels = histogram.size() / channels;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point lastCheckpoint = Clock::now();
+    std::uint64_t startSamples = totalSamples;
+    while (totalSamples < params.targetSamples && !cancelRequested()) {
+        updateSampling();
+        runPass(std::min(params.samplesPerPass, params.targetSamples - totalSamples));
+        if (cancelRequested()) {
+            break;
+        }
+        if (!params.checkpointPath.empty() &&
+            std::chrono::duration<double>(Clock::now() - lastCheckpoint).count() >=
+                params.checkpointSeconds) {
+            saveCheckpoint();
+            lastCheckpoint = Clock::now();
+        }
+        if (progressCallback && totalSamples < params.targetSamples) {
+            show();
+            progressCallback();
+        }
+    }
+    // samples of a cancelled pass count, they are as random as the others
+    if (!params.checkpointPath.empty() && totalSamples > startSamples) {
+        saveCheckpoint();
+    }
+    if (!cancelRequested()) {
+        show();
+    }
+}
+
+double Buddhabrot::computePoint(double x, double y) const {
+    return escapeTime(x, y, maxLimit);
+}
+
+// escapeTime() keeping the orbit: the same bulb test and periodicity check reject most
+// points that never escape before any of it is plotted
+int Buddhabrot::orbit(double cr, double ci, ThreadState &thread) const {
+    if (isInCardioidOrBulb(cr, ci)) {
+        return -1;
+    }
+    double zr = 0.0, zi = 0.0, zr2 = 0.0, zi2 = 0.0;
+    double zrOld = 0.0, ziOld = 0.0;
+    int checkPeriod = 20;
+    int nextCheck = checkPeriod;
+    int n = 0;
+    double *orbitR = thread.zr.data();
+    double *orbitI = thread.zi.data();
+    while (zr2 + zi2 <= 4.0 && n < maxLimit) {
+        zi = 2.0 * zr * zi + ci;
+        zr = zr2 - zi2 + cr;
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        orbitR[n] = zr;
+        orbitI[n] = zi;
+        ++n;
+        if (n == nextCheck) {
+            double diffR = zr - zrOld;
+            double diffI = zi - ziOld;
+            if (diffR * diffR + diffI * diffI < PrecisionTraits<double>::PERIOD_TOLERANCE) {
+                return -1;
+            }
+            zrOld = zr;
+            ziOld = zi;
+            nextCheck += checkPeriod;
+            checkPeriod *= 2;
+        }
+    }
+    return zr2 + zi2 > 4.0 && n < maxLimit ? n : -1;
+}
+
+// every thread draws its share into its own histogram, merged once at the end
+void Buddhabrot::runPass(std::uint64_t samples) {
+    PROFILE_SCOPE("buddhabrot pass");
+    std::uint64_t done = 0;
+    double cellSize = SPAN / GRID;
+    double uniformWeight = 1.0 / (GRID * GRID);
+    std::size_t width = frame.width, height = frame.height;
+
+#pragma omp parallel num_threads(static_cast<int>(threads.size())) reduction(+ : done)
+    {
+        std::size_t self = static_cast<std::size_t>(omp_get_thread_num());
+        ThreadState &thread = threads[self];
+        std::uint64_t share = samples / threads.size() + (self < samples % threads.size());
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::uniform_int_distribution<int> anyCell(0, GRID * GRID - 1);
+        float *counts = thread.histogram.data();
+
+        for (std::uint64_t i = 0; i < share; i++) {
+            if (i % CANCEL_CHECK_SAMPLES == 0 && cancelRequested()) {
+                break;
+            }
+            int cell = unit(thread.rng) < params.importance && !cellCdf.empty()
+                           ? static_cast<int>(std::upper_bound(cellCdf.begin(),
+                                                               cellCdf.end(),
+                                                               unit(thread.rng) * cellCdf.back()) -
+                                              cellCdf.begin())
+                           : anyCell(thread.rng);
+            cell = std::min(cell, GRID * GRID - 1);
+            double cr = -0.5 * SPAN + (cell % GRID + unit(thread.rng)) * cellSize;
+            double ci = -0.5 * SPAN + (cell / GRID + unit(thread.rng)) * cellSize;
+            auto weight = static_cast<float>(uniformWeight / cellProbability[cell]);
+            thread.cellSamples[cell] += 1.0;
+            done++;
+
+            int n = orbit(cr, ci, thread);
+            if (n < 0) {
+                continue;
+            }
+            // the orbit of conj(c) is the mirrored one, plotted for free
+            std::size_t hits = 0;
+            for (int k = 0; k < n; k++) {
+                double px = (thread.zr[k] - frame.left) / frame.dx + 0.5;
+                if (px < 0.0 || px >= static_cast<double>(width)) {
+                    continue;
+                }
+                auto x = static_cast<std::size_t>(px);
+                for (double zi : {thread.zi[k], -thread.zi[k]}) {
+                    double py = (frame.top - zi) / frame.dy + 0.5;
+                    if (py < 0.0 || py >= static_cast<double>(height)) {
+                        continue;
+                    }
+                    float *pixel = counts + (static_cast<std::size_t>(py) * width + x) * channels;
+                    for (std::size_t ch = 0; ch < channels; ch++) {
+                        if (n < params.limits[ch]) {
+                            pixel[ch] += weight;
+                        }
+                    }
+                    hits++;
+                }
+            }
+            thread.cellHits[cell] += static_cast<double>(hits);
+        }
+    }
+
+#pragma omp parallel for
+    for (std::size_t i = 0; i < histogram.size(); i++) {
+        for (ThreadState &thread : threads) {
+            histogram[i] += thread.histogram[i];
+            thread.histogram[i] = 0.0f;
+        }
+    }
+    for (ThreadState &thread : threads) {
+        for (std::size_t c = 0; c < cellHits.size(); c++) {
+            cellHits[c] += thread.cellHits[c];
+            cellSamples[c] += thread.cellSamples[c];
+        }
+        std::fill(thread.cellHits.begin(), thread.cellHits.end(), 0.0);
+        std::fill(thread.cellSamples.begin(), thread.cellSamples.end(), 0.0);
+    }
+    totalSamples += done;
+}
+
+// mean escape count of 2x2 points per cell: long orbits come from near the boundary
+void Buddhabrot::buildPrior() {
+    PROFILE_SCOPE("buddhabrot prior");
+    prior.assign(GRID * GRID, 0.0);
+    double cellSize = SPAN / GRID;
+#pragma omp parallel for schedule(dynamic)
+    for (int cell = 0; cell < GRID * GRID; cell++) {
+        ThreadState &thread = threads[static_cast<std::size_t>(omp_get_thread_num())];
+        double sum = 0.0;
+        for (int sub = 0; sub < 4; sub++) {
+            double cr = -0.5 * SPAN + (cell % GRID + 0.25 + 0.5 * (sub % 2)) * cellSize;
+            double ci = -0.5 * SPAN + (cell / GRID + 0.25 + 0.5 * (sub / 2)) * cellSize;
+            sum += std::max(0, orbit(cr, ci, thread));
+        }
+        prior[cell] = sum / 4.0;
+    }
+}
+
+// half the importance share by the prior, half by the hits per sample seen so far in the
+// frame, so zoomed views find the cells whose orbits pass through them
+void Buddhabrot::updateSampling() {
+    std::size_t cells = prior.size();
+    double priorSum = 0.0, learnedSum = 0.0;
+    std::vector<double> learned(cells, 0.0);
+    for (std::size_t c = 0; c < cells; c++) {
+        priorSum += prior[c];
+        learned[c] = cellSamples[c] > 0.0 ? cellHits[c] / cellSamples[c] : 0.0;
+        learnedSum += learned[c];
+    }
+    cellCdf.resize(cells);
+    double total = 0.0;
+    for (std::size_t c = 0; c < cells; c++) {
+        double fromPrior = priorSum > 0.0 ? prior[c] / priorSum : 0.0;
+        double fromHits = learnedSum > 0.0 ? learned[c] / learnedSum : fromPrior;
+        total += 0.5 * (fromPrior + fromHits);
+        cellCdf[c] = total;
+    }
+    double importance = total > 0.0 ? params.importance : 0.0;
+    if (total == 0.0) {
+        cellCdf.clear();
+    }
+    cellProbability.resize(cells);
+    for (std::size_t c = 0; c < cells; c++) {
+        double weight = total > 0.0 ? (cellCdf[c] - (c ? cellCdf[c - 1] : 0.0)) / total : 0.0;
+        cellProbability[c] = (1.0 - importance) / cells + importance * weight;
+    }
+}
+
+// hits per million samples, the palette through the colorizer or a channel per color
+void Buddhabrot::show() {
+    PROFILE_SCOPE("buddhabrot show");
+    std::size_t pixels = histogram.size() / channels;
+    double scale = totalSamples > 0 ? 1e6 / totalSamples : 0.0;
+    auto size = image->getSize();
+
+    if (channels == 1) {
+        field.resize(pixels);
+        for (std::size_t i = 0; i < pixels; i++) {
+            field[i] = histogram[i] > 0.0 ? static_cast<float>(histogram[i] * scale) : -1.0f;
+        }
+        prevIterCounts = field;
+        prevColorRange = rangeOf(prevIterCounts);
+        prevSize = size;
+        prevVp = *vp;
+        hasPrevVp = true;
+        colorizeField(prevIterCounts, prevColorRange);
+        return;
+    }
+
+    // white at a high quantile, a few hot pixels would leave the rest dark
+    std::vector<double> white(channels, 1.0);
+    std::vector<double> values;
+    for (std::size_t ch = 0; ch < channels; ch++) {
+        values.clear();
+        for (std::size_t i = ch; i < histogram.size(); i += channels) {
+            if (histogram[i] > 0.0) {
+                values.push_back(histogram[i]);
+            }
+        }
+        if (!values.empty()) {
+            auto at = values.begin() + static_cast<std::ptrdiff_t>(WHITE_QUANTILE *
+                                                                    (values.size() - 1));
+            std::nth_element(values.begin(), at, values.end());
+            white[ch] = *at;
+        }
+    }
+    pixelBuffer.resize(pixels * 4);
+#pragma omp parallel for
+    for (std::size_t i = 0; i < pixels; i++) {
+        for (std::size_t ch = 0; ch < 3; ch++) {
+            double value = ch < channels ? std::sqrt(histogram[i * channels + ch] / white[ch]) : 0;
+            pixelBuffer[4 * i + ch] = static_cast<std::uint8_t>(std::min(value, 1.0) * 255.0);
+        }
+        pixelBuffer[4 * i + 3] = 255;
+    }
+    image->resize(size, pixelBuffer.data());
+}
+
+bool Buddhabrot::loadCheckpoint() {
+    if (params.checkpointPath.empty()) {
+        return false;
+    }
+    std::ifstream in(params.checkpointPath, std::ios::binary);
+    CheckpointHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+    std::vector<std::int32_t> limits(channels);
+    readArray(in, limits);
+    // another frame or fractal, it is written over at the next checkpoint
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+        header.byteOrder != BYTE_ORDER_MARK || header.version != CHECKPOINT_VERSION ||
+        header.width != frame.width || header.height != frame.height ||
+        header.channels != channels || header.grid != GRID || header.left != frame.left ||
+        header.top != frame.top || header.dx != frame.dx || header.dy != frame.dy ||
+        !std::equal(limits.begin(), limits.end(), params.limits.begin())) {
+        return false;
+    }
+    std::vector<double> loaded(histogram.size());
+    std::vector<double> hits(cellHits.size()), samples(cellSamples.size());
+    readArray(in, loaded);
+    readArray(in, hits);
+    readArray(in, samples);
+    if (!in) {
+        return false;
+    }
+    histogram = std::move(loaded);
+    cellHits = std::move(hits);
+    cellSamples = std::move(samples);
+    totalSamples = header.samples;
+    return true;
+}
+
+// written beside and renamed over the old one, a crash leaves one of the two whole
+void Buddhabrot::saveCheckpoint() const {
+    PROFILE_SCOPE("buddhabrot checkpoint");
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = CHECKPOINT_VERSION;
+    header.width = frame.width;
+    header.height = frame.height;
+    header.channels = static_cast<std::uint32_t>(channels);
+    header.grid = GRID;
+    header.left = frame.left;
+    header.top = frame.top;
+    header.dx = frame.dx;
+    header.dy = frame.dy;
+    header.samples = totalSamples;
+    std::vector<std::int32_t> limits(params.limits.begin(), params.limits.end());
+
+    std::string temporary = params.checkpointPath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        writeArray(out, limits);
+        writeArray(out, histogram);
+        writeArray(out, cellHits);
+        writeArray(out, cellSamples);
+        if (!out.flush()) {
+            std::cerr << "Cannot write checkpoint " << temporary << std::endl;
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), params.checkpointPath.c_str()) != 0) {
+        std::cerr << "Cannot replace checkpoint " << params.checkpointPath << std::endl;
+    }
+}
@@ -0,0 +1,123 @@
+#include "Colorizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+Colorizer::Colorizer() : palette(preset(0)), levels(COLOR_LEVELS) {}
+
+void Colorizer::setPalette(std::vector<sf::Color> newPalette) {
+    palette = std::move(newPalette);
+    levelsValid = false;
+}
+
+std::vector<sf::Color> Colorizer::preset(std::size_t index) {
+    switch (index % 3) {
+    case 1: // fire
+        return {sf::Color(10, 0, 0),
+                sf::Color(90, 10, 0),
+                sf::Color(200, 60, 0),
+                sf::Color(255, 170, 30),
+                sf::Color(255, 240, 180)};
+    case 2: // grayscale
+        return {sf::Color(0, 0, 0), sf::Color(255, 255, 255)};
+    default:
+        return {
+            sf::Color(0, 7, 100),     // navy
+            sf::Color(18, 0, 30),     // very dark purple
+            sf::Color(60, 10, 80),    // purple
+            sf::Color(20, 30, 90),    // dark blue
+            sf::Color(80, 150, 255),  // light blue
+            sf::Color(200, 255, 200), // white
+            sf::Color(120, 200, 150), // soft green
+        };
+    }
+}
+
+ColorRange Colorizer::range(float const *field, std::size_t count) {
+    float minIter = std::numeric_limits<float>::max();
+    float maxIter = 0.0f;
+
+#pragma omp parallel for simd reduction(min : minIter) reduction(max : maxIter)
+    for (std::size_t i = 0; i < count; i++) {
+        float n = field[i];
+        bool escaped = n > 0.0f;
+        minIter = escaped && n < minIter ? n : minIter;
+        maxIter = escaped && n > maxIter ? n : maxIter;
+    }
+    return {minIter, maxIter};
+}
+
+void Colorizer::apply(float const *field,
+                      std::size_t count,
+                      ColorRange range,
+                      std::uint8_t *pixels) {
+    std::uint32_t black;
+    std::uint8_t const blackBytes[4] = {0, 0, 0, 255};
+    std::memcpy(&black, blackBytes, sizeof(black));
+
+    if (!(range.maxIter > range.minIter)) {
+        std::uint32_t *out = reinterpret_cast<std::uint32_t *>(pixels);
+        std::fill(out, out + count, black);
+        return;
+    }
+    buildLevels(range);
+
+    float minIter = static_cast<float>(range.minIter);
+    float maxIter = static_cast<float>(range.maxIter);
+    float scale = static_cast<float>((COLOR_LEVELS - 1) / (range.maxIter - range.minIter));
+    std::uint32_t const *table = levels.data();
+    std::uint32_t *out = reinterpret_cast<std::uint32_t *>(pixels);
+
+    // a locked range may not cover every value, NaN compares false and ends up black
+#pragma omp parallel for simd
+    for (std::size_t i = 0; i < count; i++) {
+        float n = field[i];
+        float clamped = n > minIter ? (n < maxIter ? n : maxIter) : minIter;
+        std::uint32_t level = static_cast<std::uint32_t>((clamped - minIter) * scale + 0.5f);
+        out[i] = n > 0.0f ? table[level] : black;
+    }
+}
+
+// log scaled like the per pixel coloring it replaces, the table makes it one lookup
+void Colorizer::buildLevels(ColorRange range) {
+    if (levelsValid && range.minIter == levelsRange.minIter &&
+        range.maxIter == levelsRange.maxIter) {
+        return;
+    }
+    double logScale = 1.0 / std::log(range.maxIter - range.minIter + 1.0);
+    double step = (range.maxIter - range.minIter) / (COLOR_LEVELS - 1);
+
+#pragma omp parallel for
+    for (std::size_t k = 0; k < COLOR_LEVELS; k++) {
+        levels[k] = paletteColor(std::log(k * step + 1.0) * logScale);
+    }
+    levelsRange = range;
+    levelsValid = true;
+}
+
+std::uint32_t Colorizer::paletteColor(double t) const {
+    sf::Color color;
+    if (t <= 0.0) {
+        color = palette.front();
+    } else if (t >= 1.0) {
+        color = palette.back();
+    } else {
+        double scaled = t * (palette.size() - 1);
+        std::size_t idx = static_cast<std::size_t>(scaled);
+        double frac = scaled - idx;
+
+        const sf::Color &c1 = palette[idx];
+        const sf::Color &c2 = palette[std::min(idx + 1, palette.size() - 1)];
+
+        color = sf::Color(static_cast<uint8_t>(c1.r + frac * (c2.r - c1.r)),
+                          static_cast<uint8_t>(c1.g + frac * (c2.g - c1.g)),
+                          static_cast<uint8_t>(c1.b + frac * (c2.b - c1.b)),
+                          255);
+    }
+    std::uint8_t const bytes[4] = {color.r, color.g, color.b, color.a};
+    std::uint32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
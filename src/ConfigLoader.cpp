@@ -2,13 +2,130 @@
 
 #include <yaml-cpp/yaml.h>
 
+namespace {
+
+// the keys of a Fractal section present in node, the others keep what params has
+void readFractal(YAML::Node const &node, ConfigLoader::FractalParams &params) {
+    params.name = node["Name"].as<std::string>(params.name);
+    params.power = node["Power"].as<unsigned>(params.power);
+    if (const auto juliaNode = node["JuliaC"]) {
+        params.juliaCr = juliaNode[0].as<double>();
+        params.juliaCi = juliaNode[1].as<double>();
+    }
+    params.subdivision = node["Subdivision"].as<bool>(params.subdivision);
+    params.subdivisionGuard = node["SubdivisionGuard"].as<bool>(params.subdivisionGuard);
+    params.doubleDoubleDeepZoom =
+        node["DoubleDoubleDeepZoom"].as<bool>(params.doubleDoubleDeepZoom);
+    params.maxIterations = node["MaxIterations"].as<int>(params.maxIterations);
+    params.iterationsPerZoomDecade =
+        node["IterationsPerZoomDecade"].as<int>(params.iterationsPerZoomDecade);
+    params.iterationDeepening = node["IterationDeepening"].as<bool>(params.iterationDeepening);
+    params.distanceEstimation = node["DistanceEstimation"].as<bool>(params.distanceEstimation);
+    params.distanceSkipping = node["DistanceSkipping"].as<bool>(params.distanceSkipping);
+    params.distanceValidation = node["DistanceValidation"].as<bool>(params.distanceValidation);
+}
+
+} // namespace
+
 ConfigLoader::ConfigLoader(std::string const& filename) {
     YAML::Node config = YAML::LoadFile(filename);
     
-    const auto windowNode = config["Window"];
-    windowParams.width = windowNode["Width"].as<unsigned>();
-    windowParams.height = windowNode["Height"].as<unsigned>();
+    if (const auto windowNode = config["Window"]) {
+        windowParams.width = windowNode["Width"].as<unsigned>(windowParams.width);
+        windowParams.height = windowNode["Height"].as<unsigned>(windowParams.height);
+    }
+
+    if (const auto fractalNode = config["Fractal"]) {
+        readFractal(fractalNode, fractalParams);
+    }
+
+    if (const auto tileCacheNode = config["TileCache"]) {
+        fractalParams.tileCacheMB = tileCacheNode["BudgetMB"].as<unsigned>();
+        if (tileCacheNode["SpillDirectory"]) {
+            fractalParams.tileSpillDirectory = tileCacheNode["SpillDirectory"].as<std::string>();
+        }
+        if (tileCacheNode["SpillMB"]) {
+            fractalParams.tileSpillMB = tileCacheNode["SpillMB"].as<unsigned>();
+        }
+    }
+
+    if (const auto interactionNode = config["Interaction"]) {
+        auto &interaction = interactionParams;
+        interaction.frameBudgetMs =
+            interactionNode["FrameBudgetMs"].as<double>(interaction.frameBudgetMs);
+        interaction.minScale = interactionNode["MinScale"].as<double>(interaction.minScale);
+        interaction.minIterationScale =
+            interactionNode["MinIterationScale"].as<double>(interaction.minIterationScale);
+    }
+
+    if (const auto posterNode = config["Poster"]) {
+        auto &poster = posterParams;
+        poster.antialiasSamples =
+            posterNode["AntialiasSamples"].as<unsigned>(poster.antialiasSamples);
+        poster.antialiasBudget = posterNode["AntialiasBudget"].as<double>(poster.antialiasBudget);
+        poster.antialiasTolerance =
+            posterNode["AntialiasTolerance"].as<double>(poster.antialiasTolerance);
+    }
+
+    if (const auto densityNode = config["Density"]) {
+        auto &density = densityParams;
+        density.samplesPerPass =
+            densityNode["SamplesPerPass"].as<std::uint64_t>(density.samplesPerPass);
+        density.targetSamples =
+            densityNode["TargetSamples"].as<std::uint64_t>(density.targetSamples);
+        density.importance = densityNode["Importance"].as<double>(density.importance);
+        density.checkpoint = densityNode["Checkpoint"].as<std::string>(density.checkpoint);
+        density.checkpointSeconds =
+            densityNode["CheckpointSeconds"].as<double>(density.checkpointSeconds);
+        if (const auto limitsNode = densityNode["NebulabrotLimits"]) {
+            density.nebulabrotLimits = limitsNode.as<std::vector<int>>();
+        }
+    }
+
+    if (const auto videoNode = config["Video"]) {
+        videoParams.width = videoNode["Width"].as<unsigned>(videoParams.width);
+        videoParams.height = videoNode["Height"].as<unsigned>(videoParams.height);
+        videoParams.fps = videoNode["FPS"].as<double>(videoParams.fps);
+        videoParams.mode = videoNode["Mode"].as<std::string>(videoParams.mode);
+        videoParams.output = videoNode["Output"].as<std::string>(videoParams.output);
+        for (const auto &keyNode : videoNode["Keyframes"]) {
+            VideoParams::Keyframe keyframe;
+            keyframe.time = keyNode["Time"].as<double>();
+            keyframe.centerX = keyNode["CenterX"].as<std::string>();
+            keyframe.centerY = keyNode["CenterY"].as<std::string>();
+            keyframe.logZoom = keyNode["LogZoom"].as<double>();
+            videoParams.keyframes.push_back(keyframe);
+        }
+    }
 
-    const auto fractalNode = config["Fractal"];
-    fractalParams.name = fractalNode["Name"].as<std::string>();
+    // after every other section, a job starts from the Fractal and TileCache sections
+    if (const auto batchNode = config["Batch"]) {
+        auto &batch = batchParams;
+        batch.smallJobPixels =
+            batchNode["SmallJobPixels"].as<std::size_t>(batch.smallJobPixels);
+        if (const auto sizeNode = batchNode["Size"]) {
+            batch.width = sizeNode[0].as<unsigned>();
+            batch.height = sizeNode[1].as<unsigned>();
+        }
+        for (const auto &jobNode : batchNode["Jobs"]) {
+            BatchParams::Job job;
+            job.output = jobNode["Output"].as<std::string>();
+            job.width = batch.width;
+            job.height = batch.height;
+            if (const auto sizeNode = jobNode["Size"]) {
+                job.width = sizeNode[0].as<unsigned>();
+                job.height = sizeNode[1].as<unsigned>();
+            }
+            if (const auto centerNode = jobNode["Center"]) {
+                job.centerX = centerNode[0].as<std::string>();
+                job.centerY = centerNode[1].as<std::string>();
+            }
+            job.viewWidth = jobNode["Width"].as<double>(job.viewWidth);
+            job.fractal = fractalParams;
+            if (const auto fractalNode = jobNode["Fractal"]) {
+                readFractal(fractalNode, job.fractal);
+            }
+            batch.jobs.push_back(std::move(job));
+        }
+    }
 }
\ No newline at end of file
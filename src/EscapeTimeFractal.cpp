@@ -0,0 +1,874 @@
+#include "EscapeTimeFractal.hpp"
+
+#include "Antialiaser.hpp"
+#include "FrameReuse.hpp"
+#include "Profiler.hpp"
+#include "TileScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+EscapeTimeFractal::EscapeTimeFractal(sf::Image *image, Viewport *vp, int maxIterations)
+    : FractalBase(image, vp),
+      maxIterations(maxIterations),
+      baseIterations(maxIterations) {}
+
+void EscapeTimeFractal::setIterationScale(double scale) { iterationScale = std::min(scale, 1.0); }
+
+void EscapeTimeFractal::setIterationLimit(int limit) {
+    baseIterations = std::clamp(limit, 1, MAX_ITERATION_LIMIT);
+}
+
+void EscapeTimeFractal::setIterationsPerZoomDecade(int perDecade) {
+    iterationsPerDecade = std::max(0, perDecade);
+}
+
+void EscapeTimeFractal::setIterationDeepening(bool enabled) {
+    deepening = enabled;
+    cappedPixels.clear();
+    // CAPPED pixels of the previous frame would count as inside
+    hasPrevVp = false;
+}
+
+void EscapeTimeFractal::setDistanceEstimation(bool enabled, bool skipping, bool validation) {
+    distanceEnabled = enabled;
+    distanceSkipping = skipping;
+    distanceValidation = validation;
+    hasPrevVp = false; // iteration counts of the previous frame are no distances
+}
+
+void EscapeTimeFractal::setPrecisionOverride(std::optional<Precision> precision) {
+    precisionOverride = precision;
+    hasPrevVp = false; // the previous frame may have been iterated in another precision
+    regionFrameValid = false;
+}
+
+int EscapeTimeFractal::frameIterations(Viewport const &frameVp) const {
+    double limit = baseIterations;
+    if (iterationsPerDecade > 0 && frameVp.width < 4.0) {
+        double decades = std::floor(2.0 * std::log10(4.0 / frameVp.width)) / 2.0;
+        limit += iterationsPerDecade * decades;
+    }
+    return static_cast<int>(std::clamp(limit * iterationScale, 1.0, double(MAX_ITERATION_LIMIT)));
+}
+
+void EscapeTimeFractal::compute() {
+    PROFILE_SCOPE("compute");
+    auto size = image->getSize();
+    std::size_t imageWidth = size.x;
+    std::size_t imageHeight = size.y;
+    std::size_t totalPixels = imageWidth * imageHeight;
+
+    std::vector<double> &iterCounts = frameCounts;
+    Viewport frameVp = *vp;
+    beginFrame(frameVp, imageWidth, imageHeight, tileCache != nullptr);
+    regionFrameValid = false;
+
+    // escaped pixels end the same at a higher limit, so do proven inside ones. Those that
+    // stopped at the lower limit go on, from their state if they are the same points
+    bool deepen = deepening && maxIterations > prevIterations;
+    bool reusable = hasPrevVp && (maxIterations == prevIterations || deepen);
+    // distances are in pixels, only frames of the same spacing share them
+    if (frame.distance) {
+        reusable = reusable && prevVp.width / prevSize.x == frameVp.width / size.x;
+    }
+    bool sameFrame = reusable && prevSize == size && prevVp.width == frameVp.width &&
+                     prevVp.height == frameVp.height && prevVp.centerX == frameVp.centerX &&
+                     prevVp.centerY == frameVp.centerY;
+    resuming = sameFrame && deepen;
+    frameCapped.clear();
+    frameStats.resumedPixels = 0;
+    diskFilledPixels = 0;
+    diskFilled.clear();
+
+    // samples of the previous frame that land exactly on a pixel (pans by whole pixels,
+    // every other pixel of a 2x zoom), the rest is shown reprojected until it is computed.
+    // A pan by whole pixels moves the kept counts over in place and only looks at the exposed
+    // bands from then on: computes, caches and colors them, without previews
+    std::vector<double> preview;
+    std::size_t reusedPixels = 0;
+    std::optional<FrameReuse> reuse;
+    if (reusable) {
+        reuse.emplace(prevVp, prevSize, frameVp, size);
+    }
+    sf::Vector2i shift;
+    bool pan = reuse && countsKept && !sameFrame && !deepen && antialiasing.maxSamples == 0 &&
+               reuse->wholePixelShift(shift);
+    countsKept = false; // until this frame is done
+    // the pixels that may be unknown, the whole frame unless panning
+    std::vector<sf::IntRect> regions{{{0, 0}, {int(imageWidth), int(imageHeight)}}};
+    std::vector<sf::IntRect> exposed;
+    if (pan) {
+        PROFILE_SCOPE("pan");
+        exposed = FrameReuse::exposedRects(size, shift);
+        regions = exposed;
+        FrameReuse::shiftPixels(iterCounts.data(), sizeof(double), size, shift);
+        reusedPixels = totalPixels;
+        for (sf::IntRect const &rect : exposed) {
+            for (int y = rect.position.y; y < rect.position.y + rect.size.y; y++) {
+                auto row = iterCounts.begin() + std::size_t(y) * imageWidth + rect.position.x;
+                std::fill(row, row + rect.size.x, std::numeric_limits<double>::quiet_NaN());
+            }
+            reusedPixels -= std::size_t(rect.size.x) * rect.size.y;
+        }
+    } else {
+        // NaN marks pixels not known yet
+        iterCounts.assign(totalPixels, std::numeric_limits<double>::quiet_NaN());
+        if (reuse) {
+            {
+                PROFILE_SCOPE("reuse");
+                reusedPixels = reuse->reuseAligned(prevIterCounts, iterCounts);
+            }
+            if (deepen) {
+                for (double &n : iterCounts) {
+                    if (n == CAPPED) {
+                        n = std::numeric_limits<double>::quiet_NaN();
+                        reusedPixels--;
+                    }
+                }
+            }
+        }
+    }
+    if (frame.onLattice) {
+        for (sf::IntRect const &region : regions) {
+            fillFromTileCache(iterCounts, region);
+        }
+    }
+    // the reprojection doubles as the cost estimate of the scheduler, a pan's bands are too
+    // thin to need one
+    if (reuse && !pan) {
+        preview = iterCounts;
+        reuse->reproject(prevIterCounts, preview);
+        if (progressCallback) {
+            colorize(iterCounts, 1, &preview);
+            progressCallback();
+        }
+    }
+
+    frameStats.pixels = totalPixels;
+    frameStats.reusedPixels = totalPixels;
+    for (sf::IntRect const &region : regions) {
+        for (int y = region.position.y; y < region.position.y + region.size.y; y++) {
+            auto row = iterCounts.begin() + std::size_t(y) * imageWidth + region.position.x;
+            frameStats.reusedPixels -=
+                std::count_if(row, row + region.size.x, [](double n) { return std::isnan(n); });
+        }
+    }
+    PROFILE_COUNT(ReusedPixels, reusedPixels);
+    PROFILE_COUNT(CachedPixels, frameStats.reusedPixels - reusedPixels);
+
+    // coarse to fine: every pass only computes the pixels on its grid not known yet,
+    // so the progressive previews cost no extra iterations. Subdivision takes over after
+    // the first preview, finer grids would iterate the regions it is meant to skip. Disk
+    // filling needs the coarse passes too, their disks spare the finer ones
+    bool subdivision = subdivisionEnabled && connectedSet();
+    bool diskFill = frame.distance && distanceSkipping;
+    bool previews = progressCallback && !pan;
+    std::size_t firstStride = previews || diskFill ? PROGRESSIVE_FIRST_STRIDE : 1;
+    std::size_t lastStride = subdivision ? PROGRESSIVE_FIRST_STRIDE : 1;
+    static_assert(TileScheduler::TILE_SIZE % PROGRESSIVE_FIRST_STRIDE == 0);
+    std::vector<TileScheduler::Tile> tileRegions;
+    for (sf::IntRect const &region : regions) {
+        tileRegions.push_back({std::size_t(region.position.x),
+                               std::size_t(region.position.y),
+                               std::size_t(region.position.x + region.size.x),
+                               std::size_t(region.position.y + region.size.y),
+                               0.0});
+    }
+    TileScheduler scheduler(imageWidth, imageHeight, tileRegions);
+    scheduler.estimateCosts(iterCounts, preview.empty() ? nullptr : &preview, maxIterations);
+    for (std::size_t stride = firstStride; stride >= lastStride; stride /= 2) {
+        scheduler.run([&](TileScheduler::Tile const &tile) {
+            if (cancelRequested()) {
+                return;
+            }
+            // the grids are the frame's, a tile clipped to a band joins them where they enter
+            std::vector<std::size_t> pending;
+            for (std::size_t y = (tile.y0 + stride - 1) / stride * stride; y < tile.y1;
+                 y += stride) {
+                for (std::size_t x = (tile.x0 + stride - 1) / stride * stride; x < tile.x1;
+                     x += stride) {
+                    std::size_t idx = y * imageWidth + x;
+                    if (std::isnan(iterCounts[idx])) {
+                        pending.push_back(idx);
+                    }
+                }
+            }
+            // disks stay in the tile, no other thread writes there
+            PixelRect bounds{tile.x0, tile.y0, tile.x1 - 1, tile.y1 - 1};
+            computeInto(
+                iterCounts.data(), pending.data(), pending.size(), diskFill ? &bounds : nullptr);
+        });
+        frameStats.workerUtilization = scheduler.utilization();
+
+        if (cancelRequested()) {
+            return;
+        }
+        if (stride > 1 && previews) {
+            colorize(iterCounts, stride, preview.empty() ? nullptr : &preview);
+            progressCallback();
+        }
+    }
+
+    if (subdivision) {
+        PROFILE_SCOPE("subdivision");
+        subdivideFrame(iterCounts, regions);
+        if (cancelRequested()) {
+            return;
+        }
+    }
+
+    frameStats.diskFilledPixels = diskFilledPixels;
+    PROFILE_COUNT(DiskFilledPixels, diskFilledPixels.load());
+    if (diskFill && distanceValidation) {
+        validateDiskFill(iterCounts);
+        if (cancelRequested()) {
+            return;
+        }
+    }
+
+    if (frame.onLattice) {
+        for (sf::IntRect const &region : regions) {
+            storeToTileCache(iterCounts, region);
+        }
+    }
+
+    if (pan) {
+        // only the exposed pixels are new, the rest moves over in place
+        PROFILE_SCOPE("pan");
+        FrameReuse::shiftPixels(prevIterCounts.data(), sizeof(float), size, shift);
+        for (sf::IntRect const &rect : exposed) {
+            for (int y = rect.position.y; y < rect.position.y + rect.size.y; y++) {
+                std::size_t row = std::size_t(y) * imageWidth + rect.position.x;
+                std::copy(iterCounts.begin() + row,
+                          iterCounts.begin() + row + rect.size.x,
+                          prevIterCounts.begin() + row);
+            }
+        }
+    } else {
+        prevIterCounts.assign(iterCounts.begin(), iterCounts.end());
+    }
+    prevVp = frameVp;
+    prevSize = size;
+    prevIterations = maxIterations;
+    hasPrevVp = true;
+    countsKept = true;
+    if (deepening) {
+        // a repeated frame iterated nothing, its pixels keep their states
+        if (!sameFrame || deepen) {
+            cappedPixels.clear();
+        }
+        cappedPixels.insert(cappedPixels.end(), frameCapped.begin(), frameCapped.end());
+        std::sort(cappedPixels.begin(),
+                  cappedPixels.end(),
+                  [](CappedPixel const &a, CappedPixel const &b) { return a.first < b.first; });
+        frameCapped.clear();
+    }
+    resuming = false;
+
+    // while panning the range only widens, the moved pixels keep their colors as long as the
+    // exposed ones fit into it. The extremes sit at the edges, the frame's own would change
+    // with nearly every pan
+    bool movePixels = pan && pixelsOfPrevField && pixelBuffer.size() == 4 * totalPixels;
+    if (movePixels && !colorRangeLocked) {
+        colorRange = pixelRange;
+        for (sf::IntRect const &rect : exposed) {
+            for (int y = rect.position.y; y < rect.position.y + rect.size.y; y++) {
+                std::size_t row = std::size_t(y) * imageWidth + rect.position.x;
+                ColorRange rowRange = Colorizer::range(prevIterCounts.data() + row, rect.size.x);
+                colorRange.minIter = std::min(colorRange.minIter, rowRange.minIter);
+                colorRange.maxIter = std::max(colorRange.maxIter, rowRange.maxIter);
+            }
+        }
+        prevColorRange = colorRange;
+    } else {
+        prevColorRange = rangeOf(prevIterCounts);
+    }
+    if (movePixels && pixelRange.minIter == prevColorRange.minIter &&
+        pixelRange.maxIter == prevColorRange.maxIter) {
+        PROFILE_SCOPE("colorize");
+        FrameReuse::shiftPixels(pixelBuffer.data(), 4, size, shift);
+        for (sf::IntRect const &rect : exposed) {
+            for (int y = rect.position.y; y < rect.position.y + rect.size.y; y++) {
+                std::size_t row = std::size_t(y) * imageWidth + rect.position.x;
+                colorizer.apply(prevIterCounts.data() + row,
+                                rect.size.x,
+                                prevColorRange,
+                                pixelBuffer.data() + 4 * row);
+            }
+        }
+        image->resize(size, pixelBuffer.data());
+        imageUpdate = {true, shift, exposed};
+    } else {
+        colorizeField(prevIterCounts, prevColorRange);
+    }
+    pixelsOfPrevField = antialiasing.maxSamples == 0;
+
+    frameStats.antialias = {};
+    if (antialiasing.maxSamples > 0) {
+        Antialiaser antialiaser(antialiasing, imageWidth, imageHeight);
+        frameStats.antialias = antialiaser.resolve(
+            prevIterCounts,
+            pixelBuffer.data(),
+            colorizer,
+            prevColorRange,
+            [this](double const *px, double const *py, std::size_t count, double *values) {
+                computeSamples(values, px, py, count);
+                for (std::size_t i = 0; i < count; i++) {
+                    values[i] = shade(values[i]);
+                }
+            });
+        image->resize(size, pixelBuffer.data());
+    }
+}
+
+std::vector<float> EscapeTimeFractal::computeRegion(Viewport const &viewport,
+                                                    unsigned width,
+                                                    unsigned height,
+                                                    unsigned x0,
+                                                    unsigned y0,
+                                                    unsigned x1,
+                                                    unsigned y1) {
+    PROFILE_SCOPE("compute region");
+    if (x0 >= x1 || y0 >= y1 || x1 > width || y1 > height) {
+        throw std::invalid_argument("Region outside of the frame");
+    }
+    // the reference orbit of a deep frame costs as much as many tiles, set up once per frame
+    bool sameFrame = regionFrameValid && regionWidth == width && regionHeight == height &&
+                     regionVp.centerX == viewport.centerX &&
+                     regionVp.centerY == viewport.centerY && regionVp.width == viewport.width &&
+                     regionVp.height == viewport.height;
+    if (!sameFrame) {
+        Viewport frameVp = viewport;
+        beginFrame(frameVp, width, height, false);
+        regionVp = viewport;
+        regionWidth = width;
+        regionHeight = height;
+        regionFrameValid = true;
+    }
+
+    std::size_t regionW = x1 - x0;
+    std::size_t regionH = y1 - y0;
+    std::vector<float> field(regionW * regionH);
+    // nothing known, every tile costs the same
+    TileScheduler scheduler(regionW, regionH);
+    std::vector<double> unknown(field.size(), std::numeric_limits<double>::quiet_NaN());
+    scheduler.estimateCosts(unknown, nullptr, maxIterations);
+    scheduler.run([&](TileScheduler::Tile const &tile) {
+        std::vector<std::size_t> indices;
+        for (std::size_t y = tile.y0; y < tile.y1; y++) {
+            for (std::size_t x = tile.x0; x < tile.x1; x++) {
+                indices.push_back((y0 + y) * frame.width + x0 + x);
+            }
+        }
+        std::vector<double> values(indices.size());
+        computePixels(values.data(), indices.data(), indices.size(), nullptr);
+        std::size_t i = 0;
+        for (std::size_t y = tile.y0; y < tile.y1; y++) {
+            for (std::size_t x = tile.x0; x < tile.x1; x++) {
+                field[y * regionW + x] = static_cast<float>(shade(values[i++]));
+            }
+        }
+    });
+    return field;
+}
+
+void EscapeTimeFractal::beginFrame(Viewport &frameVp,
+                                   std::size_t width,
+                                   std::size_t height,
+                                   bool lattice) {
+    frame.width = width;
+    frame.height = height;
+    frame.dx = frameVp.width / static_cast<double>(width);
+    frame.dy = frameVp.height / static_cast<double>(height);
+    frame.precision = precisionOverride.value_or(choosePrecision(std::min(frame.dx, frame.dy)));
+    maxIterations = frameIterations(frameVp);
+    frame.distance = distanceEnabled && estimatesDistance();
+    frame.onLattice = lattice && (frame.precision == Precision::Float ||
+                                  frame.precision == Precision::Double);
+    if (frame.onLattice) {
+        snapToLattice(frameVp);
+    } else {
+        frame.left = static_cast<double>(frameVp.centerX) - frameVp.width * 0.5;
+        frame.top = static_cast<double>(frameVp.centerY) + frameVp.height * 0.5;
+    }
+    prepareFrame(frameVp);
+}
+
+void EscapeTimeFractal::computeInto(double *iterCounts,
+                                    std::size_t const *indices,
+                                    std::size_t count,
+                                    PixelRect const *fillBounds) {
+    std::vector<double> values(count);
+    std::vector<EscapeState> states(deepening ? count : 0);
+    std::size_t resumed = 0;
+    if (resuming) {
+        for (std::size_t i = 0; i < count; i++) {
+            auto it = std::lower_bound(
+                cappedPixels.begin(),
+                cappedPixels.end(),
+                indices[i],
+                [](CappedPixel const &pixel, std::size_t idx) { return pixel.first < idx; });
+            if (it != cappedPixels.end() && it->first == indices[i]) {
+                states[i] = it->second;
+                states[i].capped = false;
+                resumed += states[i].n > 0;
+            }
+        }
+    }
+    computePixels(values.data(), indices, count, deepening ? states.data() : nullptr);
+    std::vector<CappedPixel> capped;
+    for (std::size_t i = 0; i < count; i++) {
+        if (deepening && states[i].capped) {
+            iterCounts[indices[i]] = CAPPED;
+            capped.emplace_back(indices[i], states[i]);
+        } else {
+            iterCounts[indices[i]] = shade(values[i]);
+        }
+    }
+    if (fillBounds) {
+        for (std::size_t i = 0; i < count; i++) {
+            if (values[i] > 0.0) {
+                fillDisk(iterCounts, indices[i], values[i], *fillBounds);
+            }
+        }
+    }
+    if (!deepening) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(cappedMutex);
+    frameCapped.insert(frameCapped.end(), capped.begin(), capped.end());
+    frameStats.resumedPixels += resumed;
+}
+
+double EscapeTimeFractal::shade(double value) const {
+    if (!frame.distance || value < 0.0) {
+        return value;
+    }
+    return std::min(value / frame.dx, DISTANCE_SHADE_PIXELS);
+}
+
+// the set is at least distance / 4 from the pixel, so at least DISTANCE_SHADE_PIXELS from the
+// points closer to it than the difference: their own estimates are no smaller and shade flat
+void EscapeTimeFractal::fillDisk(double *iterCounts,
+                                 std::size_t idx,
+                                 double distance,
+                                 PixelRect const &bounds) {
+    double radius = 0.25 * distance - DISTANCE_SHADE_PIXELS * frame.dx;
+    if (radius < std::min(frame.dx, frame.dy)) {
+        return;
+    }
+    auto cx = static_cast<std::int64_t>(idx % frame.width);
+    auto cy = static_cast<std::int64_t>(idx / frame.width);
+    auto rx = static_cast<std::int64_t>(radius / frame.dx);
+    auto ry = static_cast<std::int64_t>(radius / frame.dy);
+    std::int64_t x0 = std::max(cx - rx, static_cast<std::int64_t>(bounds.x0));
+    std::int64_t x1 = std::min(cx + rx, static_cast<std::int64_t>(bounds.x1));
+    std::int64_t y0 = std::max(cy - ry, static_cast<std::int64_t>(bounds.y0));
+    std::int64_t y1 = std::min(cy + ry, static_cast<std::int64_t>(bounds.y1));
+    double radius2 = radius * radius;
+    std::vector<std::size_t> filled;
+    for (std::int64_t y = y0; y <= y1; y++) {
+        double offsetY = static_cast<double>(y - cy) * frame.dy;
+        for (std::int64_t x = x0; x <= x1; x++) {
+            double offsetX = static_cast<double>(x - cx) * frame.dx;
+            std::size_t pixel = static_cast<std::size_t>(y) * frame.width + x;
+            if (std::isnan(iterCounts[pixel]) && offsetX * offsetX + offsetY * offsetY <= radius2) {
+                iterCounts[pixel] = DISTANCE_SHADE_PIXELS;
+                filled.push_back(pixel);
+            }
+        }
+    }
+    diskFilledPixels += filled.size();
+    if (distanceValidation) {
+        std::lock_guard<std::mutex> lock(diskMutex);
+        diskFilled.insert(diskFilled.end(), filled.begin(), filled.end());
+    }
+}
+
+// iterates the filled pixels after all, a full render gives every one of them the flat value
+void EscapeTimeFractal::validateDiskFill(std::vector<double> &iterCounts) {
+    constexpr std::size_t CHUNK = 1024;
+    std::size_t differ = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : differ)
+    for (std::size_t start = 0; start < diskFilled.size(); start += CHUNK) {
+        if (cancelRequested()) {
+            continue;
+        }
+        std::size_t count = std::min(CHUNK, diskFilled.size() - start);
+        std::vector<double> values(count);
+        computePixels(values.data(), diskFilled.data() + start, count, nullptr);
+        for (std::size_t i = 0; i < count; i++) {
+            double value = shade(values[i]);
+            double &filled = iterCounts[diskFilled[start + i]];
+            if (value != filled) {
+                filled = value;
+                differ++;
+            }
+        }
+    }
+    std::cout << "Distance estimation: filled " << diskFilledPixels << " of " << iterCounts.size()
+              << " pixels, " << differ << " differ from the full render" << std::endl;
+}
+
+// on the lattice the point only depends on the sample, not on where the frame starts,
+// so cached tiles match a fresh computation bit for bit
+void EscapeTimeFractal::pixelToPoint(std::size_t idx, double &cr, double &ci) const {
+    std::size_t x = idx % frame.width;
+    std::size_t y = idx / frame.width;
+    if (frame.onLattice) {
+        cr = static_cast<double>(frame.gx0 + static_cast<std::int64_t>(x)) * frame.dx;
+        ci = -static_cast<double>(frame.gy0 + static_cast<std::int64_t>(y)) * frame.dy;
+    } else {
+        cr = frame.left + static_cast<double>(x) * frame.dx;
+        ci = frame.top - static_cast<double>(y) * frame.dy;
+    }
+}
+
+void EscapeTimeFractal::pointAt(double px, double py, double &cr, double &ci) const {
+    if (frame.onLattice) {
+        cr = (static_cast<double>(frame.gx0) + px) * frame.dx;
+        ci = -(static_cast<double>(frame.gy0) + py) * frame.dy;
+    } else {
+        cr = frame.left + px * frame.dx;
+        ci = frame.top - py * frame.dy;
+    }
+}
+
+const char *EscapeTimeFractal::precisionName(Precision precision) {
+    switch (precision) {
+    case Precision::Float:
+        return "float";
+    case Precision::Double:
+        return "double";
+    case Precision::DoubleDouble:
+        return "double-double";
+    case Precision::Perturbation:
+        return "perturbation";
+    }
+    return "unknown";
+}
+
+void EscapeTimeFractal::setSubdivision(bool enabled, bool guard) {
+    subdivisionEnabled = enabled;
+    subdivisionGuard = guard;
+}
+
+void EscapeTimeFractal::setTileCache(std::size_t budgetBytes,
+                              std::string const &spillDirectory,
+                              std::size_t spillBytes) {
+    tileCache = std::make_unique<TileCache>(budgetBytes, spillDirectory, spillBytes);
+    hasPrevVp = false; // the previous frame may be off the lattice
+}
+
+namespace {
+
+std::int64_t floorDiv(std::int64_t a, std::int64_t b) {
+    std::int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+} // namespace
+
+// moves the frame by less than a pixel onto the lattice of its quantized zoom level, so
+// frames that overlap share their samples exactly
+void EscapeTimeFractal::snapToLattice(Viewport &frameVp) {
+    frame.levelX = std::llround(std::log2(frame.dx) * LATTICE_LEVELS_PER_OCTAVE);
+    frame.levelY = std::llround(std::log2(frame.dy) * LATTICE_LEVELS_PER_OCTAVE);
+    frame.dx = std::exp2(static_cast<double>(frame.levelX) / LATTICE_LEVELS_PER_OCTAVE);
+    frame.dy = std::exp2(static_cast<double>(frame.levelY) / LATTICE_LEVELS_PER_OCTAVE);
+
+    HPReal left = frameVp.centerX - 0.5 * frameVp.width;
+    HPReal top = frameVp.centerY + 0.5 * frameVp.height;
+    frame.gx0 = std::llround(static_cast<double>(left / frame.dx));
+    frame.gy0 = std::llround(static_cast<double>(-top / frame.dy));
+    frame.left = static_cast<double>(frame.gx0) * frame.dx;
+    frame.top = -static_cast<double>(frame.gy0) * frame.dy;
+
+    frameVp.width = frame.dx * static_cast<double>(frame.width);
+    frameVp.height = frame.dy * static_cast<double>(frame.height);
+    frameVp.centerX = HPReal(frame.gx0) * frame.dx + 0.5 * frameVp.width;
+    frameVp.centerY = -(HPReal(frame.gy0) * frame.dy) - 0.5 * frameVp.height;
+}
+
+// everything besides the position the cached samples depend on
+std::uint64_t EscapeTimeFractal::paramsHash() const {
+    return formulaHash() ^ (static_cast<std::uint64_t>(maxIterations) * 0x9e3779b97f4a7c15ull) ^
+           (static_cast<std::uint64_t>(frame.precision) << 56) ^
+           (static_cast<std::uint64_t>(frame.distance) << 52);
+}
+
+// copies cached samples into pixels not known yet
+void EscapeTimeFractal::fillFromTileCache(std::vector<double> &iterCounts,
+                                          sf::IntRect const &region) {
+    PROFILE_SCOPE("tile cache");
+    const std::int64_t T = TileCache::TILE_SIZE;
+    std::int64_t W = static_cast<std::int64_t>(frame.width);
+    std::int64_t rx0 = region.position.x, rx1 = region.position.x + region.size.x;
+    std::int64_t ry0 = region.position.y, ry1 = region.position.y + region.size.y;
+    std::int64_t tx0 = floorDiv(frame.gx0 + rx0, T), tx1 = floorDiv(frame.gx0 + rx1 - 1, T);
+    std::int64_t ty0 = floorDiv(frame.gy0 + ry0, T), ty1 = floorDiv(frame.gy0 + ry1 - 1, T);
+    std::uint64_t params = paramsHash();
+
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (std::int64_t ty = ty0; ty <= ty1; ty++) {
+        for (std::int64_t tx = tx0; tx <= tx1; tx++) {
+            TileCache::Tile tile;
+            if (!tileCache->find({frame.levelX, frame.levelY, tx, ty, params}, tile)) {
+                continue;
+            }
+            std::int64_t x0 = std::max<std::int64_t>(tx * T - frame.gx0, rx0);
+            std::int64_t x1 = std::min<std::int64_t>((tx + 1) * T - frame.gx0, rx1);
+            std::int64_t y0 = std::max<std::int64_t>(ty * T - frame.gy0, ry0);
+            std::int64_t y1 = std::min<std::int64_t>((ty + 1) * T - frame.gy0, ry1);
+            for (std::int64_t y = y0; y < y1; y++) {
+                for (std::int64_t x = x0; x < x1; x++) {
+                    double &n = iterCounts[y * W + x];
+                    if (std::isnan(n)) {
+                        n = tile[(frame.gy0 + y - ty * T) * T + (frame.gx0 + x - tx * T)];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// tiles on the region edge are only partly covered, the cache merges them with what it has
+void EscapeTimeFractal::storeToTileCache(std::vector<double> const &iterCounts,
+                                         sf::IntRect const &region) {
+    PROFILE_SCOPE("tile cache");
+    const std::int64_t T = TileCache::TILE_SIZE;
+    std::int64_t W = static_cast<std::int64_t>(frame.width);
+    std::int64_t rx0 = region.position.x, rx1 = region.position.x + region.size.x;
+    std::int64_t ry0 = region.position.y, ry1 = region.position.y + region.size.y;
+    std::int64_t tx0 = floorDiv(frame.gx0 + rx0, T), tx1 = floorDiv(frame.gx0 + rx1 - 1, T);
+    std::int64_t ty0 = floorDiv(frame.gy0 + ry0, T), ty1 = floorDiv(frame.gy0 + ry1 - 1, T);
+    std::uint64_t params = paramsHash();
+
+#pragma omp parallel for collapse(2) schedule(dynamic)
+    for (std::int64_t ty = ty0; ty <= ty1; ty++) {
+        for (std::int64_t tx = tx0; tx <= tx1; tx++) {
+            TileCache::Tile tile(TileCache::TILE_SAMPLES, std::numeric_limits<double>::quiet_NaN());
+            std::int64_t x0 = std::max<std::int64_t>(tx * T - frame.gx0, rx0);
+            std::int64_t x1 = std::min<std::int64_t>((tx + 1) * T - frame.gx0, rx1);
+            std::int64_t y0 = std::max<std::int64_t>(ty * T - frame.gy0, ry0);
+            std::int64_t y1 = std::min<std::int64_t>((ty + 1) * T - frame.gy0, ry1);
+            for (std::int64_t y = y0; y < y1; y++) {
+                for (std::int64_t x = x0; x < x1; x++) {
+                    tile[(frame.gy0 + y - ty * T) * T + (frame.gx0 + x - tx * T)] =
+                        iterCounts[y * W + x];
+                }
+            }
+            tileCache->insert({frame.levelX, frame.levelY, tx, ty, params}, tile);
+        }
+    }
+}
+
+// Mariani-Silver: compute the border of a rectangle, fill it if the border agrees, else split
+void EscapeTimeFractal::subdivideFrame(std::vector<double> &iterCounts,
+                                       std::vector<sf::IntRect> const &regions) {
+    filledPixels = 0;
+    guardFailures = 0;
+
+    std::vector<PixelRect> rects;
+    std::size_t pixels = 0;
+    std::vector<std::size_t> border;
+    for (sf::IntRect const &region : regions) {
+        PixelRect rect{std::size_t(region.position.x),
+                       std::size_t(region.position.y),
+                       std::size_t(region.position.x + region.size.x - 1),
+                       std::size_t(region.position.y + region.size.y - 1)};
+        for (std::size_t x = rect.x0; x <= rect.x1; x++) {
+            border.push_back(rect.y0 * frame.width + x);
+            border.push_back(rect.y1 * frame.width + x);
+        }
+        for (std::size_t y = rect.y0 + 1; y < rect.y1; y++) {
+            border.push_back(y * frame.width + rect.x0);
+            border.push_back(y * frame.width + rect.x1);
+        }
+        rects.push_back(rect);
+        pixels += std::size_t(region.size.x) * region.size.y;
+    }
+    // a one pixel band lists its pixels twice, computing them twice costs more than a sort
+    std::sort(border.begin(), border.end());
+    border.erase(std::unique(border.begin(), border.end()), border.end());
+    border.erase(std::remove_if(border.begin(),
+                                border.end(),
+                                [&](std::size_t idx) { return !std::isnan(iterCounts[idx]); }),
+                 border.end());
+    computeInto(iterCounts.data(), border.data(), border.size());
+
+#pragma omp parallel
+#pragma omp single
+    for (PixelRect const &rect : rects) {
+        subdivide(iterCounts.data(), rect);
+    }
+
+    PROFILE_COUNT(FilledPixels, filledPixels.load());
+    if (subdivisionGuard) {
+        std::cout << "Subdivision: filled " << filledPixels << " of " << pixels
+                  << " pixels, " << guardFailures << " guard failures" << std::endl;
+    }
+}
+
+// the border of rect is known, its inside is not necessarily
+void EscapeTimeFractal::subdivide(double *iterCounts, PixelRect rect) {
+    if (cancelRequested()) {
+        return;
+    }
+    std::size_t W = frame.width;
+    std::size_t rectWidth = rect.x1 - rect.x0 + 1;
+    std::size_t rectHeight = rect.y1 - rect.y0 + 1;
+
+    if (rectWidth <= 2 || rectHeight <= 2) {
+        return;
+    }
+    if (rectWidth <= SUBDIVISION_MIN_SIZE || rectHeight <= SUBDIVISION_MIN_SIZE) {
+        std::vector<std::size_t> inside;
+        for (std::size_t y = rect.y0 + 1; y < rect.y1; y++) {
+            for (std::size_t x = rect.x0 + 1; x < rect.x1; x++) {
+                inside.push_back(y * W + x);
+            }
+        }
+        computeUnknown(iterCounts, std::move(inside));
+        return;
+    }
+
+    // the whole border has one value, in practice -1: the set has no holes so it is all inside
+    double value = iterCounts[rect.y0 * W + rect.x0];
+    auto agrees = [&](double n) { return n == value; };
+    bool uniform = true;
+    for (std::size_t x = rect.x0; x <= rect.x1 && uniform; x++) {
+        uniform = agrees(iterCounts[rect.y0 * W + x]) && agrees(iterCounts[rect.y1 * W + x]);
+    }
+    for (std::size_t y = rect.y0; y <= rect.y1 && uniform; y++) {
+        uniform = agrees(iterCounts[y * W + rect.x0]) && agrees(iterCounts[y * W + rect.x1]);
+    }
+    // pixels already known inside (previous frame, coarse pass) must agree too
+    std::vector<std::size_t> unknown;
+    for (std::size_t y = rect.y0 + 1; y < rect.y1 && uniform; y++) {
+        for (std::size_t x = rect.x0 + 1; x < rect.x1 && uniform; x++) {
+            double n = iterCounts[y * W + x];
+            if (std::isnan(n)) {
+                unknown.push_back(y * W + x);
+            } else {
+                uniform = agrees(n);
+            }
+        }
+    }
+
+    if (uniform) {
+        if (unknown.empty()) {
+            return; // all known already, from a previous frame or the cache
+        }
+        for (std::size_t idx : unknown) {
+            iterCounts[idx] = value;
+        }
+        if (!subdivisionGuard || guardRect(unknown, value)) {
+            filledPixels += unknown.size();
+            return;
+        }
+        guardFailures++;
+        computeInto(iterCounts, unknown.data(), unknown.size());
+        return;
+    }
+
+    // split in four, the dividing row and column become the children's borders
+    std::size_t xm = (rect.x0 + rect.x1) / 2;
+    std::size_t ym = (rect.y0 + rect.y1) / 2;
+    std::vector<std::size_t> cross;
+    for (std::size_t x = rect.x0 + 1; x < rect.x1; x++) {
+        cross.push_back(ym * W + x);
+    }
+    for (std::size_t y = rect.y0 + 1; y < rect.y1; y++) {
+        if (y != ym) {
+            cross.push_back(y * W + xm);
+        }
+    }
+    computeUnknown(iterCounts, cross);
+
+    PixelRect children[4] = {{rect.x0, rect.y0, xm, ym},
+                             {xm, rect.y0, rect.x1, ym},
+                             {rect.x0, ym, xm, rect.y1},
+                             {xm, ym, rect.x1, rect.y1}};
+    bool spawnTasks = rectWidth * rectHeight >= SUBDIVISION_TASK_AREA;
+    for (PixelRect const &child : children) {
+        if (spawnTasks) {
+#pragma omp task firstprivate(child)
+            subdivide(iterCounts, child);
+        } else {
+            subdivide(iterCounts, child);
+        }
+    }
+#pragma omp taskwait
+}
+
+void EscapeTimeFractal::computeUnknown(double *iterCounts, std::vector<std::size_t> indices) {
+    indices.erase(std::remove_if(indices.begin(),
+                                 indices.end(),
+                                 [&](std::size_t idx) { return !std::isnan(iterCounts[idx]); }),
+                  indices.end());
+    computeInto(iterCounts, indices.data(), indices.size());
+}
+
+// iterates a few filled pixels for real, false if any of them disagrees with the fill
+bool EscapeTimeFractal::guardRect(std::vector<std::size_t> const &filled, double value) const {
+    if (filled.empty()) {
+        return true;
+    }
+    std::size_t samples = std::min(filled.size(), 4 + filled.size() / 256);
+    std::size_t step = filled.size() / samples;
+    for (std::size_t i = 0; i < samples; i++) {
+        // spread over the rectangle, offset so the samples are not all on one row
+        std::size_t idx = filled[(i * step + step / 2) % filled.size()];
+        // a pixel stopped at the limit is -1 outside of the field
+        if (shade(computePixel(idx)) != (value == CAPPED ? -1.0 : value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// pixels not known yet take their reprojected preview value if there is one,
+// else the corner of their stride x stride block which is known
+void EscapeTimeFractal::colorize(std::vector<double> const &iterCounts,
+                          std::size_t stride,
+                          std::vector<double> const *preview) {
+    std::size_t imageWidth = frame.width;
+    std::size_t imageHeight = frame.height;
+    shownField.resize(iterCounts.size());
+
+#pragma omp parallel for
+    for (std::size_t y = 0; y < imageHeight; y++) {
+        for (std::size_t x = 0; x < imageWidth; x++) {
+            std::size_t idx = y * imageWidth + x;
+            double n = iterCounts[idx];
+            if (std::isnan(n) && preview && !std::isnan((*preview)[idx])) {
+                n = (*preview)[idx];
+            } else if (std::isnan(n)) {
+                n = iterCounts[(y - y % stride) * imageWidth + (x - x % stride)];
+            }
+            shownField[idx] = static_cast<float>(n);
+        }
+    }
+    colorizeField(shownField, rangeOf(shownField));
+}
+
+
+EscapeTimeFractal::Precision EscapeTimeFractal::choosePrecision(double) const {
+    return Precision::Double;
+}
+
+void EscapeTimeFractal::prepareFrame(Viewport const &) {}
+
+bool EscapeTimeFractal::connectedSet() const {
+    return true;
+}
+
+bool EscapeTimeFractal::estimatesDistance() const {
+    return false;
+}
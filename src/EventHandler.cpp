@@ -1,8 +1,13 @@
 #include "EventHandler.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include <iostream>
+#include <stdexcept>
 
+#include "PosterExporter.hpp"
+#include "Profiler.hpp"
 #include "Timer.hpp"
 
 EventHandler::EventHandler(sf::RenderWindow &window,
@@ -10,68 +15,93 @@ EventHandler::EventHandler(sf::RenderWindow &window,
                            std::unique_ptr<FractalBase> fractal,
                            sf::Image *image,
                            sf::Texture &texture,
-                           Viewport *viewport)
+                           Viewport *viewport,
+                           AntialiasParams posterAntialiasing,
+                           QualityParams interactiveQuality)
     : window(window),
       image(image),
       texture(texture),
       sprite(sprite),
       fractal(std::move(fractal)),
-      viewport(viewport) {}
+      viewport(viewport),
+      posterAntialiasing(posterAntialiasing),
+      renderer(*this->fractal, image, interactiveQuality) {
+    renderer.request(*viewport);
+}
 
 void EventHandler::run() {
     while (window.isOpen()) {
-        while (auto event = window.pollEvent()) {
-            if (event->is<sf::Event::Closed>()) {
-                handleQuitEvent(window);
-            }
-            if (auto *e = event->getIf<sf::Event::KeyPressed>()) {
-                if (e->code == sf::Keyboard::Key::Left || e->code == sf::Keyboard::Key::Right ||
-                    e->code == sf::Keyboard::Key::Up || e->code == sf::Keyboard::Key::Down) {
-                    handleArrowKeyEvent(*e, viewport);
-                } else if (e->code == sf::Keyboard::Key::Escape ||
-                           e->code == sf::Keyboard::Key::Q) {
-                    handleQuitEvent(window);
-                } else if (e->code == sf::Keyboard::Key::J || e->code == sf::Keyboard::Key::K) {
-                    handleZoomWithKeyboard(*e);
-                } else if (e->code == sf::Keyboard::Key::S) {
-                    handleSaveImageEvent();
-                }
-            }
-            if (auto *e = event->getIf<sf::Event::MouseWheelScrolled>()) {
-                handleMouseWheelEvent(*e);
-            }
-            if (auto *e = event->getIf<sf::Event::MouseButtonPressed>()) {
-                handleMouseButtonPressed(*e);
-            }
-            if (auto *e = event->getIf<sf::Event::MouseButtonReleased>()) {
-                handleMouseButtonReleased(*e);
-            }
-            if (event->is<sf::Event::MouseMoved>() && dragging) {
-                handleMouseMoved();
-            }
-        }
+        handleEvents();
         if (needsRedraw) {
             updateViewportAndRedraw();
             needsRedraw = false;
+        } else if (refinePending && std::chrono::steady_clock::now() - lastInput >= REFINE_DELAY) {
+            renderer.refine();
+            refinePending = false;
+        }
+        if (renderer.uploadIfReady(texture, sprite)) {
+            sprite.setTexture(texture);
         }
+        PROFILE_SCOPE("draw");
         window.clear();
         window.draw(sprite);
         window.display();
     }
 }
 
+void EventHandler::handleEvents() {
+    PROFILE_SCOPE("events");
+    while (auto event = window.pollEvent()) {
+        if (event->is<sf::Event::Closed>()) {
+            handleQuitEvent(window);
+        }
+        if (auto *e = event->getIf<sf::Event::KeyPressed>()) {
+            if (e->code == sf::Keyboard::Key::Left || e->code == sf::Keyboard::Key::Right ||
+                e->code == sf::Keyboard::Key::Up || e->code == sf::Keyboard::Key::Down) {
+                handleArrowKeyEvent(*e, viewport);
+            } else if (e->code == sf::Keyboard::Key::Escape || e->code == sf::Keyboard::Key::Q) {
+                handleQuitEvent(window);
+            } else if (e->code == sf::Keyboard::Key::J || e->code == sf::Keyboard::Key::K) {
+                handleZoomWithKeyboard(*e);
+            } else if (e->code == sf::Keyboard::Key::S) {
+                handleSaveImageEvent();
+            } else if (e->code == sf::Keyboard::Key::C) {
+                handleNextPaletteEvent();
+            } else if (e->code == sf::Keyboard::Key::I || e->code == sf::Keyboard::Key::U) {
+                handleIterationLimitEvent(*e);
+            }
+        }
+        if (auto *e = event->getIf<sf::Event::MouseWheelScrolled>()) {
+            handleMouseWheelEvent(*e);
+        }
+        if (auto *e = event->getIf<sf::Event::MouseButtonPressed>()) {
+            handleMouseButtonPressed(*e);
+        }
+        if (auto *e = event->getIf<sf::Event::MouseButtonReleased>()) {
+            handleMouseButtonReleased(*e);
+        }
+        if (event->is<sf::Event::MouseMoved>() && dragging) {
+            handleMouseMoved();
+        }
+    }
+}
+
 void EventHandler::handleQuitEvent(sf::RenderWindow &window) { window.close(); }
 
 void EventHandler::handleArrowKeyEvent(sf::Event::KeyPressed const &e, Viewport *viewport) {
     double panFactor = 0.1; // % of the viewport size
+    auto winSize = window.getSize();
+    // rounded to whole pixels so the next frame can reuse every overlapping sample
+    double stepX = std::round(panFactor * winSize.x) * (viewport->width / winSize.x);
+    double stepY = std::round(panFactor * winSize.y) * (viewport->height / winSize.y);
     if (e.code == sf::Keyboard::Key::Left) {
-        viewport->centerX += panFactor * viewport->width;
+        viewport->centerX += stepX;
     } else if (e.code == sf::Keyboard::Key::Right) {
-        viewport->centerX -= panFactor * viewport->width;
+        viewport->centerX -= stepX;
     } else if (e.code == sf::Keyboard::Key::Up) {
-        viewport->centerY -= panFactor * viewport->height;
+        viewport->centerY -= stepY;
     } else if (e.code == sf::Keyboard::Key::Down) {
-        viewport->centerY += panFactor * viewport->height;
+        viewport->centerY += stepY;
     }
     needsRedraw = true;
 }
@@ -148,18 +178,11 @@ void EventHandler::handleSaveImageEvent() {
 
     auto [width, height] = formats.at(formatChoice);
     std::cout << "Rendering image of size " << width << "x" << height << "..." << std::endl;
-    sf::Image saveImage({static_cast<unsigned int>(width), static_cast<unsigned int>(height)});
     Viewport saveVP = *viewport;
 
     double aspectTarget = double(width) / double(height);
     saveVP.height = saveVP.width / aspectTarget;
 
-    FractalBase* fractalPtr = fractal.get();
-    
-    fractalPtr->backupAndReplacePointers(&saveImage, &saveVP);
-    timeFunction([&] { fractalPtr->compute(); });
-    fractalPtr->restoreBackedUpPointers();
-
     // Get current time for timestamp
     auto t = std::time(nullptr);
     std::tm tm;
@@ -167,19 +190,51 @@ void EventHandler::handleSaveImageEvent() {
     char timestamp[32];
     std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &tm);
     std::string filename = "images/fractal_" + formatChoice + "_" + timestamp + ".png";
-    if (saveImage.saveToFile(filename)) {
+
+    // streamed in strips, a 2a0 poster would not fit in memory whole
+    bool saved = false;
+    renderer.runExclusive([&] {
+        try {
+            PosterExporter exporter(*fractal, posterAntialiasing);
+            timeFunction([&] { exporter.save(saveVP, width, height, filename); });
+            saved = true;
+        } catch (std::runtime_error const &error) {
+            std::cout << error.what() << std::endl;
+        }
+    });
+
+    if (saved) {
         std::cout << "Image saved to " << filename << std::endl;
     } else {
         std::cout << "Failed to save image to " << filename << std::endl;
     }
 }
 
+// only recolors, the iteration field of the shown frame stays as it is
+void EventHandler::handleNextPaletteEvent() {
+    paletteIndex++;
+    std::vector<sf::Color> palette = Colorizer::preset(paletteIndex);
+    renderer.requestRecolor([palette](FractalBase &fractal) { fractal.setPalette(palette); });
+}
+
+// raising it only iterates the pixels that hit the old limit when deepening is on
+void EventHandler::handleIterationLimitEvent(sf::Event::KeyPressed const &e) {
+    int limit = fractal->iterationLimit();
+    if (limit == 0) {
+        return;
+    }
+    limit = e.code == sf::Keyboard::Key::I ? std::min(limit * 2, FractalBase::MAX_ITERATION_LIMIT)
+                                           : std::max(1, limit / 2);
+    std::cout << "Iteration limit: " << limit << std::endl;
+    renderer.requestChange([limit](FractalBase &fractal) { fractal.setIterationLimit(limit); });
+}
+
 void EventHandler::applyZoomAtMouse(double zoomFactor) {
     sf::Vector2i mouse = sf::Mouse::getPosition(window);
     auto winSize = window.getSize();
 
-    double mx = (mouse.x - winSize.x / 2.0) * (viewport->width / winSize.x) + viewport->centerX;
-    double my = -(mouse.y - winSize.y / 2.0) * (viewport->height / winSize.y) + viewport->centerY;
+    HPReal mx = (mouse.x - winSize.x / 2.0) * (viewport->width / winSize.x) + viewport->centerX;
+    HPReal my = -(mouse.y - winSize.y / 2.0) * (viewport->height / winSize.y) + viewport->centerY;
 
     viewport->width /= zoomFactor;
     viewport->height /= zoomFactor;
@@ -193,7 +248,7 @@ void EventHandler::applyZoomAtMouse(double zoomFactor) {
 }
 
 void EventHandler::updateViewportAndRedraw() {
-    timeFunction([&] { fractal->compute(); });
-    texture.update(*image);
-    sprite.setTexture(texture);
+    renderer.requestInteractive(*viewport);
+    refinePending = true;
+    lastInput = std::chrono::steady_clock::now();
 }
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "FieldFile.hpp"
+
+#include "TileProtocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'F', 'R', 'C', 'T', 'F', 'L', 'D', 0};
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* start of the first page, the encoded job follows it */
+struct Prefix {
+    char magic[8];
+    std::uint32_t byteOrder;
+    std::uint32_t version;
+    std::uint32_t tileSize;
+    std::uint32_t jobBytes;
+    double minIter, maxIter;
+};
+
+std::size_t roundUp(std::size_t bytes, std::size_t to) {
+    return (bytes + to - 1) / to * to;
+}
+
+std::runtime_error failure(std::string const &what, std::string const &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// msync wants the start on a page of the host, which may be larger than the file's 4 KB
+bool syncRange(unsigned char *mapping, std::size_t offset, std::size_t bytes) {
+    std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t start = offset / page * page;
+    return ::msync(mapping + start, offset + bytes - start, MS_SYNC) == 0;
+}
+
+} // namespace
+
+FieldFile::FieldFile(std::string const &path, FieldHeader const &header)
+    : writable(true),
+      fileHeader(header) {
+    tileprotocol::Job job;
+    job.fractal = header.fractal;
+    job.viewport = header.viewport;
+    job.width = header.width;
+    job.height = header.height;
+    std::vector<std::uint8_t> encoded = tileprotocol::encodeJob(job);
+    if (sizeof(Prefix) + encoded.size() > BITMAP_OFFSET) {
+        throw std::runtime_error("Field file header does not fit its page");
+    }
+    if (header.width == 0 || header.height == 0 || header.tileSize == 0) {
+        throw std::invalid_argument("Empty field file");
+    }
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw failure("Cannot create field file", path);
+    }
+    columns = (header.width + header.tileSize - 1) / header.tileSize;
+    tileRows = (header.height + header.tileSize - 1) / header.tileSize;
+    tileBytes = std::size_t(header.tileSize) * header.tileSize * sizeof(float);
+    dataOffset = BITMAP_OFFSET + roundUp((tileCount() + 7) / 8, BITMAP_OFFSET);
+    std::size_t bytes = dataOffset + tileCount() * tileBytes;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        ::close(fd);
+        throw failure("Cannot size field file", path);
+    }
+    map(bytes);
+
+    Prefix prefix{};
+    std::memcpy(prefix.magic, MAGIC, sizeof(MAGIC));
+    prefix.byteOrder = BYTE_ORDER_MARK;
+    prefix.version = VERSION;
+    prefix.tileSize = header.tileSize;
+    prefix.jobBytes = static_cast<std::uint32_t>(encoded.size());
+    prefix.minIter = header.colorRange.minIter;
+    prefix.maxIter = header.colorRange.maxIter;
+    std::memcpy(mapping, &prefix, sizeof(prefix));
+    std::memcpy(mapping + sizeof(prefix), encoded.data(), encoded.size());
+    if (!syncRange(mapping, 0, BITMAP_OFFSET)) {
+        std::runtime_error error = failure("Cannot write field file", path);
+        unmap();
+        throw error;
+    }
+}
+
+FieldFile::FieldFile(std::string const &path, bool writable) : writable(writable) {
+    fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        throw failure("Cannot open field file", path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < BITMAP_OFFSET) {
+        ::close(fd);
+        throw std::runtime_error("Not a field file: " + path);
+    }
+    map(static_cast<std::size_t>(info.st_size));
+    try {
+        readHeader(path);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+    if (!writable) {
+        ::madvise(mapping, mappedBytes, MADV_SEQUENTIAL);
+    }
+}
+
+void FieldFile::readHeader(std::string const &path) {
+    Prefix prefix;
+    std::memcpy(&prefix, mapping, sizeof(prefix));
+    if (std::memcmp(prefix.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a field file: " + path);
+    }
+    if (prefix.byteOrder != BYTE_ORDER_MARK || prefix.version != VERSION) {
+        throw std::runtime_error("Field file of another version or byte order: " + path);
+    }
+    if (prefix.tileSize == 0 || sizeof(prefix) + prefix.jobBytes > BITMAP_OFFSET) {
+        throw std::runtime_error("Corrupt field file header: " + path);
+    }
+    std::vector<std::uint8_t> encoded(mapping + sizeof(prefix),
+                                      mapping + sizeof(prefix) + prefix.jobBytes);
+    tileprotocol::Job job = tileprotocol::decodeJob(encoded);
+    fileHeader.fractal = job.fractal;
+    fileHeader.viewport = job.viewport;
+    fileHeader.width = job.width;
+    fileHeader.height = job.height;
+    fileHeader.tileSize = prefix.tileSize;
+    fileHeader.colorRange = {prefix.minIter, prefix.maxIter};
+
+    columns = (job.width + prefix.tileSize - 1) / prefix.tileSize;
+    tileRows = (job.height + prefix.tileSize - 1) / prefix.tileSize;
+    tileBytes = std::size_t(prefix.tileSize) * prefix.tileSize * sizeof(float);
+    dataOffset = BITMAP_OFFSET + roundUp((tileCount() + 7) / 8, BITMAP_OFFSET);
+    if (mappedBytes != dataOffset + tileCount() * tileBytes) {
+        throw std::runtime_error("Truncated field file: " + path);
+    }
+}
+
+FieldFile::~FieldFile() {
+    try {
+        sync();
+    } catch (std::runtime_error const &) {
+        // the tiles are rendered again next time
+    }
+    unmap();
+}
+
+void FieldFile::map(std::size_t bytes) {
+    int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *newMapping = ::mmap(nullptr, bytes, protection, MAP_SHARED, fd, 0);
+    if (newMapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(std::string("Cannot map field file: ") + std::strerror(errno));
+    }
+    mapping = static_cast<unsigned char *>(newMapping);
+    mappedBytes = bytes;
+}
+
+void FieldFile::unmap() {
+    ::munmap(mapping, mappedBytes);
+    ::close(fd);
+}
+
+bool FieldFile::tileDone(std::size_t tile) const {
+    return bitmap()[tile / 8] & (1u << (tile % 8));
+}
+
+std::size_t FieldFile::tilesDone() const {
+    std::size_t done = 0;
+    for (std::size_t i = 0; i < tileCount(); i++) {
+        done += tileDone(i);
+    }
+    return done;
+}
+
+float const *FieldFile::tile(std::size_t tile) const {
+    return reinterpret_cast<float const *>(mapping + dataOffset + tile * tileBytes);
+}
+
+void FieldFile::readRows(unsigned y0, unsigned rows, float *field) const {
+    unsigned size = fileHeader.tileSize;
+    for (unsigned y = y0; y < y0 + rows; y++) {
+        float const *tileRow = tile((y / size) * columns) + std::size_t(y % size) * size;
+        for (std::size_t tx = 0; tx < columns; tx++) {
+            unsigned x0 = static_cast<unsigned>(tx * size);
+            unsigned count = std::min(size, fileHeader.width - x0);
+            std::copy(tileRow,
+                      tileRow + count,
+                      field + std::size_t(y - y0) * fileHeader.width + x0);
+            tileRow += tileBytes / sizeof(float);
+        }
+    }
+}
+
+void FieldFile::writeTile(std::size_t tile, float const *field) {
+    if (!writable) {
+        throw std::runtime_error("Field file opened read only");
+    }
+    unsigned size = fileHeader.tileSize;
+    unsigned x0 = static_cast<unsigned>(tile % columns) * size;
+    unsigned y0 = static_cast<unsigned>(tile / columns) * size;
+    unsigned tileWidth = std::min(size, fileHeader.width - x0);
+    unsigned rows = std::min(size, fileHeader.height - y0);
+    float *dst = reinterpret_cast<float *>(mapping + dataOffset + tile * tileBytes);
+    for (unsigned y = 0; y < rows; y++) {
+        std::copy(field + std::size_t(y) * tileWidth,
+                  field + std::size_t(y + 1) * tileWidth,
+                  dst + std::size_t(y) * size);
+    }
+    unsynced.push_back(tile);
+}
+
+// values first, a crash between the two only loses the bits
+void FieldFile::sync() {
+    if (unsynced.empty()) {
+        return;
+    }
+    if (!syncRange(mapping, dataOffset, mappedBytes - dataOffset)) {
+        throw std::runtime_error(std::string("Cannot sync field file: ") + std::strerror(errno));
+    }
+    for (std::size_t tile : unsynced) {
+        bitmap()[tile / 8] |= static_cast<unsigned char>(1u << (tile % 8));
+    }
+    unsynced.clear();
+    if (!syncRange(mapping, BITMAP_OFFSET, dataOffset - BITMAP_OFFSET)) {
+        throw std::runtime_error(std::string("Cannot sync field file: ") + std::strerror(errno));
+    }
+}
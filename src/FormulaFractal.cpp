@@ -0,0 +1,12 @@
+#include "FormulaFractal.hpp"
+
+// one pixel loop per formula, compiled here once instead of in every includer
+template class FormulaFractal<formula::Julia>;
+template class FormulaFractal<formula::BurningShip>;
+template class FormulaFractal<formula::Tricorn>;
+template class FormulaFractal<formula::Multibrot<3>>;
+template class FormulaFractal<formula::Multibrot<4>>;
+template class FormulaFractal<formula::Multibrot<5>>;
+template class FormulaFractal<formula::Multibrot<6>>;
+template class FormulaFractal<formula::Multibrot<7>>;
+template class FormulaFractal<formula::Multibrot<8>>;
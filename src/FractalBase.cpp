@@ -1,5 +1,7 @@
 #include "FractalBase.hpp"
 
+#include "Profiler.hpp"
+
 void FractalBase::backupAndReplacePointers(sf::Image *newImage, Viewport *newVp) {
     backupImage = image;
     backupVp = vp;
@@ -10,4 +12,54 @@ void FractalBase::backupAndReplacePointers(sf::Image *newImage, Viewport *newVp)
 void FractalBase::restoreBackedUpPointers() {
     image = backupImage;
     vp = backupVp;
-}
\ No newline at end of file
+}
+
+void FractalBase::setTarget(sf::Image *newImage, Viewport *newVp) {
+    image = newImage;
+    vp = newVp;
+}
+
+void FractalBase::forgetPreviousFrame() {
+    hasPrevVp = false;
+    pixelsOfPrevField = false;
+}
+
+void FractalBase::setProgressCallback(std::function<void()> callback) {
+    progressCallback = std::move(callback);
+}
+
+void FractalBase::lockColorRange(ColorRange range) {
+    colorRange = range;
+    colorRangeLocked = true;
+}
+
+void FractalBase::unlockColorRange() { colorRangeLocked = false; }
+
+void FractalBase::setPalette(std::vector<sf::Color> palette) {
+    colorizer.setPalette(std::move(palette));
+    pixelsOfPrevField = false;
+}
+
+void FractalBase::recolor() {
+    if (hasPrevVp && prevSize == image->getSize()) {
+        colorizeField(prevIterCounts, colorRangeLocked ? colorRange : prevColorRange);
+        pixelsOfPrevField = true;
+    }
+}
+
+ColorRange FractalBase::rangeOf(std::vector<float> const &field) {
+    if (!colorRangeLocked) {
+        colorRange = Colorizer::range(field.data(), field.size());
+    }
+    return colorRange;
+}
+
+void FractalBase::colorizeField(std::vector<float> const &field, ColorRange range) {
+    PROFILE_SCOPE("colorize");
+    pixelBuffer.resize(field.size() * 4);
+    colorizer.apply(field.data(), field.size(), range, pixelBuffer.data());
+    image->resize(image->getSize(), pixelBuffer.data());
+    pixelsOfPrevField = false;
+    pixelRange = range;
+    imageUpdate = {};
+}
@@ -0,0 +1,96 @@
+#include "FractalFactory.hpp"
+
+#include "Buddhabrot.hpp"
+#include "FormulaFractal.hpp"
+#include "Mandelbrot.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+std::unique_ptr<EscapeTimeFractal> makeMultibrot(unsigned power, sf::Image *image, Viewport *vp) {
+    switch (power) {
+    case 3:
+        return std::make_unique<FormulaFractal<formula::Multibrot<3>>>(image, vp);
+    case 4:
+        return std::make_unique<FormulaFractal<formula::Multibrot<4>>>(image, vp);
+    case 5:
+        return std::make_unique<FormulaFractal<formula::Multibrot<5>>>(image, vp);
+    case 6:
+        return std::make_unique<FormulaFractal<formula::Multibrot<6>>>(image, vp);
+    case 7:
+        return std::make_unique<FormulaFractal<formula::Multibrot<7>>>(image, vp);
+    case 8:
+        return std::make_unique<FormulaFractal<formula::Multibrot<8>>>(image, vp);
+    default:
+        throw std::runtime_error("Unsupported Multibrot power: " + std::to_string(power) +
+                                 ", 3 to 8");
+    }
+}
+
+} // namespace
+
+std::unique_ptr<EscapeTimeFractal> makeFractal(ConfigLoader::FractalParams const &params,
+                                               sf::Image *image,
+                                               Viewport *vp) {
+    std::unique_ptr<EscapeTimeFractal> fractal;
+    if (params.name == "Mandelbrot" || (params.name == "Multibrot" && params.power == 2)) {
+        auto mandelbrot = std::make_unique<Mandelbrot>(image, vp);
+        mandelbrot->setDoubleDoubleDeepZoom(params.doubleDoubleDeepZoom);
+        fractal = std::move(mandelbrot);
+    } else if (params.name == "Multibrot") {
+        fractal = makeMultibrot(params.power, image, vp);
+    } else if (params.name == "Julia") {
+        formula::Julia julia;
+        julia.cr = params.juliaCr;
+        julia.ci = params.juliaCi;
+        fractal = std::make_unique<FormulaFractal<formula::Julia>>(image, vp, julia);
+    } else if (params.name == "BurningShip") {
+        fractal = std::make_unique<FormulaFractal<formula::BurningShip>>(image, vp);
+    } else if (params.name == "Tricorn") {
+        fractal = std::make_unique<FormulaFractal<formula::Tricorn>>(image, vp);
+    } else {
+        throw std::runtime_error("Unknown fractal: " + params.name);
+    }
+
+    fractal->setIterationLimit(params.maxIterations);
+    fractal->setIterationsPerZoomDecade(params.iterationsPerZoomDecade);
+    fractal->setIterationDeepening(params.iterationDeepening);
+    fractal->setSubdivision(params.subdivision, params.subdivisionGuard);
+    fractal->setDistanceEstimation(
+        params.distanceEstimation, params.distanceSkipping, params.distanceValidation);
+    if (params.tileCacheMB > 0) {
+        fractal->setTileCache(std::size_t(params.tileCacheMB) << 20,
+                              params.tileSpillDirectory,
+                              std::size_t(params.tileSpillMB) << 20);
+    }
+    return fractal;
+}
+
+bool isDensityFractal(std::string const &name) {
+    return name == "Buddhabrot" || name == "Nebulabrot";
+}
+
+std::unique_ptr<FractalBase> makeDensityFractal(ConfigLoader::FractalParams const &params,
+                                                ConfigLoader::DensityParams const &density,
+                                                sf::Image *image,
+                                                Viewport *vp) {
+    DensityParams densityParams;
+    if (params.name == "Buddhabrot") {
+        densityParams.limits = {params.maxIterations};
+    } else if (params.name == "Nebulabrot") {
+        densityParams.limits = density.nebulabrotLimits;
+    } else {
+        throw std::runtime_error("Not a density fractal: " + params.name);
+    }
+    if (densityParams.limits.empty() || densityParams.limits.size() > 3) {
+        throw std::runtime_error("A density fractal takes 1 to 3 iteration limits");
+    }
+    densityParams.samplesPerPass = density.samplesPerPass;
+    densityParams.targetSamples = density.targetSamples;
+    densityParams.importance = density.importance;
+    densityParams.checkpointPath = density.checkpoint;
+    densityParams.checkpointSeconds = density.checkpointSeconds;
+    return std::make_unique<Buddhabrot>(image, vp, std::move(densityParams));
+}
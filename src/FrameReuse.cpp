@@ -0,0 +1,149 @@
+#include "FrameReuse.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+FrameReuse::FrameReuse(Viewport const &prevVp,
+                       sf::Vector2u prevSize,
+                       Viewport const &vp,
+                       sf::Vector2u size)
+    : prevSize(prevSize), size(size) {
+    double prevDx = prevVp.width / prevSize.x;
+    double prevDy = prevVp.height / prevSize.y;
+    double dx = vp.width / size.x;
+    double dy = vp.height / size.y;
+
+    // the center difference in high precision, it is what keeps deep zoom pans exact
+    HPReal leftShift = (vp.centerX - prevVp.centerX) - 0.5 * (vp.width - prevVp.width);
+    HPReal topShift = (prevVp.centerY - vp.centerY) - 0.5 * (vp.height - prevVp.height);
+    offsetX = static_cast<double>(leftShift / prevDx);
+    offsetY = static_cast<double>(topShift / prevDy);
+    scaleX = dx / prevDx;
+    scaleY = dy / prevDy;
+}
+
+std::vector<long> FrameReuse::alignedSources(double offset,
+                                             double scale,
+                                             unsigned count,
+                                             unsigned prevCount) const {
+    std::vector<long> sources(count, -1);
+    for (unsigned i = 0; i < count; i++) {
+        double src = offset + i * scale;
+        double rounded = std::round(src);
+        if (std::abs(src - rounded) < ALIGN_TOLERANCE && rounded >= 0 && rounded < prevCount) {
+            sources[i] = static_cast<long>(rounded);
+        }
+    }
+    return sources;
+}
+
+std::vector<long> FrameReuse::nearestSources(double offset,
+                                             double scale,
+                                             unsigned count,
+                                             unsigned prevCount) const {
+    std::vector<long> sources(count, -1);
+    for (unsigned i = 0; i < count; i++) {
+        double rounded = std::round(offset + i * scale);
+        if (rounded >= 0 && rounded < prevCount) {
+            sources[i] = static_cast<long>(rounded);
+        }
+    }
+    return sources;
+}
+
+std::size_t FrameReuse::reuseAligned(std::vector<float> const &prev,
+                                     std::vector<double> &next) const {
+    std::vector<long> cols = alignedSources(offsetX, scaleX, size.x, prevSize.x);
+    std::vector<long> rows = alignedSources(offsetY, scaleY, size.y, prevSize.y);
+
+    std::size_t reused = 0;
+#pragma omp parallel for reduction(+ : reused)
+    for (unsigned y = 0; y < size.y; y++) {
+        if (rows[y] < 0) {
+            continue;
+        }
+        float const *src = prev.data() + rows[y] * prevSize.x;
+        double *dst = next.data() + std::size_t(y) * size.x;
+        for (unsigned x = 0; x < size.x; x++) {
+            if (cols[x] >= 0) {
+                dst[x] = src[cols[x]];
+                reused++;
+            }
+        }
+    }
+    return reused;
+}
+
+void FrameReuse::reproject(std::vector<float> const &prev, std::vector<double> &preview) const {
+    std::vector<long> cols = nearestSources(offsetX, scaleX, size.x, prevSize.x);
+    std::vector<long> rows = nearestSources(offsetY, scaleY, size.y, prevSize.y);
+
+#pragma omp parallel for
+    for (unsigned y = 0; y < size.y; y++) {
+        if (rows[y] < 0) {
+            continue;
+        }
+        float const *src = prev.data() + rows[y] * prevSize.x;
+        double *dst = preview.data() + std::size_t(y) * size.x;
+        for (unsigned x = 0; x < size.x; x++) {
+            if (cols[x] >= 0 && std::isnan(dst[x])) {
+                dst[x] = src[cols[x]];
+            }
+        }
+    }
+}
+
+bool FrameReuse::wholePixelShift(sf::Vector2i &shift) const {
+    if (prevSize != size || scaleX != 1.0 || scaleY != 1.0) {
+        return false;
+    }
+    double x = std::round(offsetX);
+    double y = std::round(offsetY);
+    if (std::abs(offsetX - x) >= ALIGN_TOLERANCE || std::abs(offsetY - y) >= ALIGN_TOLERANCE ||
+        std::abs(x) >= size.x || std::abs(y) >= size.y) {
+        return false;
+    }
+    shift = {static_cast<int>(x), static_cast<int>(y)};
+    return true;
+}
+
+std::vector<sf::IntRect> FrameReuse::exposedRects(sf::Vector2u size, sf::Vector2i shift) {
+    int width = static_cast<int>(size.x);
+    int height = static_cast<int>(size.y);
+    std::vector<sf::IntRect> rects;
+    int rowsTop = shift.y > 0 ? 0 : -shift.y;
+    int rowsBottom = shift.y > 0 ? height - shift.y : height;
+    if (shift.y != 0) {
+        int y = shift.y > 0 ? rowsBottom : 0;
+        rects.push_back({{0, y}, {width, std::abs(shift.y)}});
+    }
+    if (shift.x != 0) {
+        int x = shift.x > 0 ? width - shift.x : 0;
+        rects.push_back({{x, rowsTop}, {std::abs(shift.x), rowsBottom - rowsTop}});
+    }
+    return rects;
+}
+
+void FrameReuse::shiftPixels(void *pixels,
+                             std::size_t pixelBytes,
+                             sf::Vector2u size,
+                             sf::Vector2i shift) {
+    auto *bytes = static_cast<std::uint8_t *>(pixels);
+    std::size_t rowBytes = size.x * pixelBytes;
+    long width = size.x, height = size.y;
+    long x0 = std::max(0L, -long(shift.x));
+    long x1 = std::min(width, width - shift.x);
+    long y0 = std::max(0L, -long(shift.y));
+    long y1 = std::min(height, height - shift.y);
+    std::size_t count = (x1 - x0) * pixelBytes;
+    // rows move towards the exposed band, walk away from it so no source is overwritten first
+    for (long i = 0; i < y1 - y0; i++) {
+        long y = shift.y > 0 ? y0 + i : y1 - 1 - i;
+        std::memmove(bytes + y * rowBytes + x0 * pixelBytes,
+                     bytes + (y + shift.y) * rowBytes + (x0 + shift.x) * pixelBytes,
+                     count);
+    }
+}
@@ -1,192 +1,304 @@
 #include "Mandelbrot.hpp"
 
+#include "EscapeTime.hpp"
+#include "Profiler.hpp"
+
 #include <cmath>
-#include <cstdint>
-#include <iostream>
+#include <functional>
 
 Mandelbrot::Mandelbrot(sf::Image *image, Viewport *vp)
-    : FractalBase(image, vp),
-      maxIterations(2000),
-      colorPalette{
-          sf::Color(0, 7, 100),     // navy
-          sf::Color(18, 0, 30),     // very dark purple
-          sf::Color(60, 10, 80),    // purple
-          sf::Color(20, 30, 90),    // dark blue
-          sf::Color(80, 150, 255),  // light blue
-          sf::Color(200, 255, 200), // white
-          sf::Color(120, 200, 150), // soft green
-      } {
-    initPaletteCache();
-}
-
-void Mandelbrot::compute() {
-    auto size = image->getSize();
-    std::size_t imageWidth = size.x;
-    std::size_t imageHeight = size.y;
-    std::size_t totalPixels = imageWidth * imageHeight;
-
-    double dx = vp->width / static_cast<double>(imageWidth);
-    double dy = vp->height / static_cast<double>(imageHeight);
-
-    std::vector<double> iterCounts(totalPixels, -1.0);
+    : EscapeTimeFractal(image, vp, 2000),
+      kernel(maxIterations) {}
 
-    bool useOverlapOptimization = false;
-    double offsetX = 0.0;
-    double offsetY = 0.0;
+void Mandelbrot::computePixels(double *values,
+                               std::size_t const *indices,
+                               std::size_t count,
+                               EscapeState *states) {
+    double halfWidth = 0.5 * static_cast<double>(frame.width);
+    double halfHeight = 0.5 * static_cast<double>(frame.height);
 
-    if (hasPrevVp) {
-        if (std::abs(vp->width - prevVp.width) < 1e-12 &&
-            std::abs(vp->height - prevVp.height) < 1e-12) {
-            offsetX = (prevVp.centerX - vp->centerX) / dx;
-            offsetY = (prevVp.centerY - vp->centerY) / dy;
-            useOverlapOptimization = true;
+    if (frame.distance) {
+        PROFILE_COUNT(Pixels, count);
+        for (std::size_t i = 0; i < count; i++) {
+            double x = static_cast<double>(indices[i] % frame.width);
+            double y = static_cast<double>(indices[i] / frame.width);
+            values[i] = distanceAt(x, y, states ? states + i : nullptr);
         }
+        return;
     }
-
-    double left = vp->centerX - vp->width * 0.5;
-    double top = vp->centerY + vp->height * 0.5;
-
-    double minIter = std::numeric_limits<double>::max();
-    double maxIter = 0;
-
-#pragma omp parallel for collapse(2) reduction(min : minIter) reduction(max : maxIter)
-    for (std::size_t y = 0; y < imageHeight; y++) {
-        for (std::size_t x = 0; x < imageWidth; x++) {
-            std::size_t idx = y * imageWidth + x;
-            double n = -1.0;
-            bool reused = false;
-
-            if (useOverlapOptimization && !prevIterCounts.empty()) {
-                double srcX = static_cast<double>(x) - offsetX;
-                double srcY = static_cast<double>(y) + offsetY;
-
-                int srcXi = static_cast<int>(srcX + 0.5);
-                int srcYi = static_cast<int>(srcY + 0.5);
-
-                if (srcXi >= 0 && srcXi < static_cast<int>(imageWidth) && srcYi >= 0 &&
-                    srcYi < static_cast<int>(imageHeight)) {
-                    std::size_t srcIdx = static_cast<std::size_t>(srcYi) * imageWidth +
-                                         static_cast<std::size_t>(srcXi);
-                    if (srcIdx < prevIterCounts.size()) {
-                        n = prevIterCounts[srcIdx];
-                        reused = true;
-                    }
-                }
-            }
-
-            if (!reused) {
-                double cx = left + static_cast<double>(x) * dx;
-                double cy = top - static_cast<double>(y) * dy;
-                n = computePoint(cx, cy);
+    if (frame.precision == Precision::Perturbation) {
+        PROFILE_COUNT(Pixels, count);
+        for (std::size_t i = 0; i < count; i++) {
+            std::size_t x = indices[i] % frame.width;
+            std::size_t y = indices[i] / frame.width;
+            double dcr = (static_cast<double>(x) - halfWidth) * frame.dx;
+            double dci = (halfHeight - static_cast<double>(y)) * frame.dy;
+            values[i] = computePointPerturbed(dcr, dci, states ? states + i : nullptr);
+        }
+        return;
+    }
+    if (frame.precision == Precision::DoubleDouble) {
+        PROFILE_COUNT(Pixels, count);
+        int period = 0; // of the pixel before, neighbours tend to share their cycle
+        for (std::size_t i = 0; i < count; i++) {
+            std::size_t x = indices[i] % frame.width;
+            std::size_t y = indices[i] / frame.width;
+            DoubleDouble cr = leftDD + doubledouble::twoProduct(static_cast<double>(x), frame.dx);
+            DoubleDouble ci = topDD - doubledouble::twoProduct(static_cast<double>(y), frame.dy);
+            EscapeState state;
+            values[i] = escapeTime(cr, ci, maxIterations, states ? &state : nullptr, &period);
+            if (state.capped) {
+                // z in double-double does not fit the state, the pixel starts over
+                states[i] = EscapeState{};
+                states[i].capped = true;
             }
+        }
+        return;
+    }
 
-            iterCounts[idx] = n;
+    // handed to the kernel in one batch
+    std::vector<double> cr(count), ci(count);
+    for (std::size_t i = 0; i < count; i++) {
+        pixelToPoint(indices[i], cr[i], ci[i]);
+    }
+    if (frame.precision == Precision::Float) {
+        kernel.computePointsFloat(cr.data(), ci.data(), count, values, states);
+    } else {
+        kernel.computePoints(cr.data(), ci.data(), count, values, states);
+    }
+}
 
-            if (n > 0) {
-                minIter = std::min(minIter, n);
-                maxIter = std::max(maxIter, n);
-            }
+// the pixel paths with fractional coordinates
+void Mandelbrot::computeSamples(double *values,
+                                double const *px,
+                                double const *py,
+                                std::size_t count) const {
+    double halfWidth = 0.5 * static_cast<double>(frame.width);
+    double halfHeight = 0.5 * static_cast<double>(frame.height);
+    if (frame.distance) {
+        for (std::size_t i = 0; i < count; i++) {
+            values[i] = distanceAt(px[i], py[i], nullptr);
         }
+        return;
+    }
+    if (frame.precision == Precision::Perturbation) {
+        for (std::size_t i = 0; i < count; i++) {
+            values[i] = computePointPerturbed(
+                (px[i] - halfWidth) * frame.dx, (halfHeight - py[i]) * frame.dy, nullptr);
+        }
+        return;
+    }
+    if (frame.precision == Precision::DoubleDouble) {
+        int period = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            DoubleDouble cr = leftDD + doubledouble::twoProduct(px[i], frame.dx);
+            DoubleDouble ci = topDD - doubledouble::twoProduct(py[i], frame.dy);
+            values[i] = escapeTime(cr, ci, maxIterations, nullptr, &period);
+        }
+        return;
     }
 
-    prevIterCounts = std::move(iterCounts);
-    prevVp = *vp;
-    hasPrevVp = true;
+    std::vector<double> cr(count), ci(count);
+    for (std::size_t i = 0; i < count; i++) {
+        pointAt(px[i], py[i], cr[i], ci[i]);
+    }
+    if (frame.precision == Precision::Float) {
+        kernel.computePointsFloat(cr.data(), ci.data(), count, values);
+    } else {
+        kernel.computePoints(cr.data(), ci.data(), count, values);
+    }
+}
 
-    double logScale = 1.0 / std::log(maxIter - minIter + 1.0);
+double Mandelbrot::computePixel(std::size_t idx) const {
+    std::size_t x = idx % frame.width;
+    std::size_t y = idx / frame.width;
+    if (frame.distance) {
+        return distanceAt(static_cast<double>(x), static_cast<double>(y), nullptr);
+    }
+    if (frame.precision == Precision::Perturbation) {
+        double dcr = (static_cast<double>(x) - 0.5 * static_cast<double>(frame.width)) * frame.dx;
+        double dci = (0.5 * static_cast<double>(frame.height) - static_cast<double>(y)) * frame.dy;
+        return computePointPerturbed(dcr, dci, nullptr);
+    }
+    if (frame.precision == Precision::DoubleDouble) {
+        DoubleDouble cr = leftDD + doubledouble::twoProduct(static_cast<double>(x), frame.dx);
+        DoubleDouble ci = topDD - doubledouble::twoProduct(static_cast<double>(y), frame.dy);
+        return escapeTime(cr, ci, maxIterations);
+    }
+    // same result as the batched kernel
+    double cr, ci;
+    pixelToPoint(idx, cr, ci);
+    if (frame.precision == Precision::Float) {
+        return escapeTime(static_cast<float>(cr), static_cast<float>(ci), maxIterations);
+    }
+    return escapeTime(cr, ci, maxIterations);
+}
 
-#pragma omp parallel for collapse(2)
-    for (std::size_t y = 0; y < imageHeight; y++) {
-        for (std::size_t x = 0; x < imageWidth; x++) {
-            std::size_t idx = y * imageWidth + x;
-            double n = prevIterCounts[idx];
+// cheapest scalar type whose rounding stays well below the pixel spacing
+Mandelbrot::Precision Mandelbrot::choosePrecision(double spacing) const {
+    if (spacing >= FLOAT_THRESHOLD) {
+        return Precision::Float;
+    }
+    if (spacing >= PERTURBATION_THRESHOLD) {
+        return Precision::Double;
+    }
+    if (doubleDoubleDeepZoom && spacing >= DOUBLE_DOUBLE_THRESHOLD) {
+        return Precision::DoubleDouble;
+    }
+    return Precision::Perturbation;
+}
 
-            sf::Color sfColor(0, 0, 0, 255);
-            if (n > 0.0 && maxIter > minIter) {
-                double t = std::log(n - minIter + 1.0) * logScale;
-                sfColor = getPaletteColor(t);
-            }
-            image->setPixel({static_cast<unsigned int>(x), static_cast<unsigned int>(y)}, sfColor);
-        }
+void Mandelbrot::setDoubleDoubleDeepZoom(bool enabled) {
+    doubleDoubleDeepZoom = enabled;
+}
+
+void Mandelbrot::prepareFrame(Viewport const &frameVp) {
+    kernel.setMaxIterations(maxIterations);
+    if (frame.precision == Precision::DoubleDouble) {
+        HPReal left = frameVp.centerX - frameVp.width * 0.5;
+        HPReal top = frameVp.centerY + frameVp.height * 0.5;
+        double leftHi = static_cast<double>(left), topHi = static_cast<double>(top);
+        leftDD = {leftHi, static_cast<double>(left - leftHi)};
+        topDD = {topHi, static_cast<double>(top - topHi)};
     }
+    if (frame.precision == Precision::Perturbation) {
+        PROFILE_SCOPE("reference orbit");
+        referenceOrbit.compute(frameVp.centerX, frameVp.centerY, maxIterations);
+        double maxDelta = 0.5 * std::hypot(frameVp.width, frameVp.height);
+        series.compute(referenceOrbit, maxDelta, maxIterations);
+    }
+}
+
+std::uint64_t Mandelbrot::formulaHash() const {
+    return std::hash<std::string>{}("Mandelbrot");
 }
 
 // returns iteration count, or -1 if inside set
 double Mandelbrot::computePoint(double cr, double ci) const {
-    double crShifted = cr - 0.25;
-    double q = crShifted * crShifted + ci * ci;
-    if (q * (q + crShifted) < 0.25 * ci * ci) {
-        return -1;
-    }
-    double crPlus1 = cr + 1.0;
-    if (crPlus1 * crPlus1 + ci * ci < 0.0625) {
-        return -1;
+    return escapeTime(cr, ci, maxIterations);
+}
+
+// z = Z_m + dz where Z is the reference orbit, dz' = (2 Z_m + dz) dz + dc
+double Mandelbrot::computePointPerturbed(double dcr, double dci, EscapeState *state) const {
+    const double *refR = referenceOrbit.zr.data();
+    const double *refI = referenceOrbit.zi.data();
+    const int refLast = referenceOrbit.size() - 1;
+
+    double dzr, dzi;
+    int n, m;
+    bool resumed = state && state->n > 0;
+    if (resumed) {
+        dzr = state->zr;
+        dzi = state->zi;
+        n = state->n;
+        m = state->m;
+    } else {
+        series.evaluate(dcr, dci, dzr, dzi);
+        n = series.skip();
+        m = n;
     }
-    double zr = 0.0, zi = 0.0;
-    double zr2 = 0.0, zi2 = 0.0;
-    double zrOld = 0.0, ziOld = 0.0;
-    int checkPeriod = 20;
-    int nextCheck = checkPeriod;
-    int n = 0;
-    while (zr2 + zi2 <= 4.0 && n < maxIterations) {
-        zi = 2.0 * zr * zi + ci;
-        zr = zr2 - zi2 + cr;
-        zr2 = zr * zr;
-        zi2 = zi * zi;
-        ++n;
-        if (n == nextCheck) {
-            double diffR = zr - zrOld;
-            double diffI = zi - ziOld;
-            if (diffR * diffR + diffI * diffI < 1e-20) {
-                return -1;
-            }
-            zrOld = zr;
-            ziOld = zi;
-            nextCheck += checkPeriod;
-            checkPeriod *= 2;
+    int start = n;
+    double modulus2 = 0.0;
+    while (true) {
+        double zr = refR[m] + dzr;
+        double zi = refI[m] + dzi;
+        modulus2 = zr * zr + zi * zi;
+        if (modulus2 > 4.0 || n >= maxIterations) {
+            break;
+        }
+        // glitch: the delta outgrew the orbit or the orbit escaped, rebase onto Z_0 = 0
+        if (modulus2 < dzr * dzr + dzi * dzi || m == refLast) {
+            dzr = zr;
+            dzi = zi;
+            m = 0;
         }
+        double tr = 2.0 * refR[m] + dzr;
+        double ti = 2.0 * refI[m] + dzi;
+        double nextR = tr * dzr - ti * dzi + dcr;
+        dzi = tr * dzi + ti * dzr + dci;
+        dzr = nextR;
+        ++m;
+        ++n;
     }
-    if (n == maxIterations) {
+    PROFILE_COUNT(SeriesSkippedIterations, resumed ? 0 : start);
+    PROFILE_COUNT(Iterations, n - start);
+    if (n >= maxIterations) {
+        if (state) {
+            *state = EscapeState{};
+            state->zr = dzr;
+            state->zi = dzi;
+            state->n = n;
+            state->m = m;
+            state->capped = true;
+        }
         return -1;
     } else {
-        double log_zn = std::log(zr2 + zi2) / 2.0;
-        double nu = std::log(log_zn / std::log(2.0)) / std::log(2.0);
-        return n + 1.0 - nu;
+        return smoothIterationCount(n, modulus2);
     }
 }
 
-void Mandelbrot::initPaletteCache() {
-    paletteCache.resize(PALETTE_CACHE_SIZE);
-
-    for (int i = 0; i < PALETTE_CACHE_SIZE; i++) {
-        double t = i / static_cast<double>(PALETTE_CACHE_SIZE - 1);
-
-        if (t <= 0.0) {
-            paletteCache[i] = colorPalette.front();
-        } else if (t >= 1.0) {
-            paletteCache[i] = colorPalette.back();
-        } else {
-            double scaled = t * (colorPalette.size() - 1);
-            std::size_t idx = static_cast<std::size_t>(scaled);
-            double frac = scaled - idx;
+double Mandelbrot::distanceAt(double px, double py, EscapeState *state) const {
+    if (frame.precision == Precision::Perturbation) {
+        double dcr = (px - 0.5 * static_cast<double>(frame.width)) * frame.dx;
+        double dci = (0.5 * static_cast<double>(frame.height) - py) * frame.dy;
+        return distancePerturbed(dcr, dci, state);
+    }
+    if (frame.precision == Precision::DoubleDouble) {
+        DoubleDouble cr = leftDD + doubledouble::twoProduct(px, frame.dx);
+        DoubleDouble ci = topDD - doubledouble::twoProduct(py, frame.dy);
+        return distanceEstimate(cr, ci, maxIterations, state);
+    }
+    double cr, ci;
+    pointAt(px, py, cr, ci);
+    if (frame.precision == Precision::Float) {
+        return distanceEstimate(
+            static_cast<float>(cr), static_cast<float>(ci), maxIterations, state);
+    }
+    return distanceEstimate(cr, ci, maxIterations, state);
+}
 
-            const sf::Color &c1 = colorPalette[idx];
-            const sf::Color &c2 = colorPalette[std::min(idx + 1, colorPalette.size() - 1)];
+// computePointPerturbed() from z = 0 carrying dz/dc of the whole z, the series approximation
+// has no derivative
+double Mandelbrot::distancePerturbed(double dcr, double dci, EscapeState *state) const {
+    const double *refR = referenceOrbit.zr.data();
+    const double *refI = referenceOrbit.zi.data();
+    const int refLast = referenceOrbit.size() - 1;
 
-            paletteCache[i] = sf::Color(static_cast<uint8_t>(c1.r + frac * (c2.r - c1.r)),
-                                        static_cast<uint8_t>(c1.g + frac * (c2.g - c1.g)),
-                                        static_cast<uint8_t>(c1.b + frac * (c2.b - c1.b)),
-                                        255);
+    double dzr = 0.0, dzi = 0.0;
+    double derR = 0.0, derI = 0.0;
+    int n = 0, m = 0;
+    double modulus2 = 0.0;
+    while (true) {
+        double zr = refR[m] + dzr;
+        double zi = refI[m] + dzi;
+        modulus2 = zr * zr + zi * zi;
+        if (modulus2 > DISTANCE_ESCAPE_RADIUS2 || n >= maxIterations) {
+            break;
+        }
+        if (modulus2 < dzr * dzr + dzi * dzi || m == refLast) {
+            dzr = zr;
+            dzi = zi;
+            m = 0;
+        }
+        double nextDerR = 2.0 * (zr * derR - zi * derI) + 1.0;
+        derI = 2.0 * (zr * derI + zi * derR);
+        derR = nextDerR;
+        double tr = 2.0 * refR[m] + dzr;
+        double ti = 2.0 * refI[m] + dzi;
+        double nextR = tr * dzr - ti * dzi + dcr;
+        dzi = tr * dzi + ti * dzr + dci;
+        dzr = nextR;
+        ++m;
+        ++n;
+    }
+    PROFILE_COUNT(Iterations, n);
+    if (n >= maxIterations) {
+        if (state) {
+            *state = EscapeState{};
+            state->capped = true;
         }
+        return -1;
     }
+    double modulus = std::sqrt(modulus2);
+    return 2.0 * modulus * std::log(modulus) / std::hypot(derR, derI);
 }
-
-inline sf::Color Mandelbrot::getPaletteColor(double t) const {
-    if (t <= 0.0)
-        return paletteCache.front();
-    if (t >= 1.0)
-        return paletteCache.back();
-
-    int index = static_cast<int>(t * (PALETTE_CACHE_SIZE - 1) + 0.5);
-    return paletteCache[index];
-}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "Perturbation.hpp"
+
+#include <algorithm>
+
+void ReferenceOrbit::compute(HPReal const &cr, HPReal const &ci, int maxIterations) {
+    zr.clear();
+    zi.clear();
+    zr.reserve(maxIterations + 1);
+    zi.reserve(maxIterations + 1);
+
+    HPReal x = 0, y = 0;
+    zr.push_back(0.0);
+    zi.push_back(0.0);
+    for (int n = 0; n < maxIterations; n++) {
+        HPReal x2 = x * x;
+        HPReal y2 = y * y;
+        y = 2 * x * y + ci;
+        x = x2 - y2 + cr;
+
+        double xd = static_cast<double>(x);
+        double yd = static_cast<double>(y);
+        zr.push_back(xd);
+        zi.push_back(yd);
+        if (xd * xd + yd * yd > 4.0) {
+            break;
+        }
+    }
+}
+
+void SeriesApproximation::compute(ReferenceOrbit const &orbit, double maxDelta, int maxIterations) {
+    // the dropped quartic term is well below the cubic one while |c| stays this small next to |a|
+    static constexpr double tolerance = 1e-9;
+
+    invMaxDelta = 1.0 / maxDelta;
+    skipIterations = 0;
+    ar = ai = br = bi = cr = ci = 0.0;
+
+    double aR = 0.0, aI = 0.0, bR = 0.0, bI = 0.0, cR = 0.0, cI = 0.0;
+    int last = std::min(orbit.size() - 1, maxIterations - 1);
+    for (int n = 0; n < last; n++) {
+        double zr = orbit.zr[n];
+        double zi = orbit.zi[n];
+
+        // a' = 2 Z a + maxDelta, b' = 2 Z b + a^2, c' = 2 Z c + 2 a b
+        double naR = 2.0 * (zr * aR - zi * aI) + maxDelta;
+        double naI = 2.0 * (zr * aI + zi * aR);
+        double nbR = 2.0 * (zr * bR - zi * bI) + aR * aR - aI * aI;
+        double nbI = 2.0 * (zr * bI + zi * bR) + 2.0 * aR * aI;
+        double ncR = 2.0 * (zr * cR - zi * cI) + 2.0 * (aR * bR - aI * bI);
+        double ncI = 2.0 * (zr * cI + zi * cR) + 2.0 * (aR * bI + aI * bR);
+
+        double aNorm = naR * naR + naI * naI;
+        double cNorm = ncR * ncR + ncI * ncI;
+        if (!(cNorm <= tolerance * tolerance * aNorm)) {
+            break;
+        }
+
+        aR = naR, aI = naI, bR = nbR, bI = nbI, cR = ncR, cI = ncI;
+        skipIterations = n + 1;
+    }
+
+    ar = aR, ai = aI, br = bR, bi = bI, cr = cR, ci = cI;
+}
+
+void SeriesApproximation::evaluate(double dcr, double dci, double &dzr, double &dzi) const {
+    double ur = dcr * invMaxDelta;
+    double ui = dci * invMaxDelta;
+
+    // Horner: ((c u + b) u + a) u
+    double tr = cr * ur - ci * ui + br;
+    double ti = cr * ui + ci * ur + bi;
+    double sr = tr * ur - ti * ui + ar;
+    double si = tr * ui + ti * ur + ai;
+    dzr = sr * ur - si * ui;
+    dzi = sr * ui + si * ur;
+}
@@ -0,0 +1,85 @@
+#include "PngStreamWriter.hpp"
+
+#include <png.h>
+
+#include <csetjmp>
+#include <stdexcept>
+
+PngStreamWriter::PngStreamWriter(std::string const &filename, unsigned width, unsigned height)
+    : filename(filename), height(height) {
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    png_structp pngPtr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop infoPtr = pngPtr ? png_create_info_struct(pngPtr) : nullptr;
+    png = pngPtr;
+    info = infoPtr;
+    if (!infoPtr) {
+        release();
+        throw std::runtime_error("Cannot create png writer for " + filename);
+    }
+    // libpng reports errors by longjmp, turned into an exception once back in C++
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        release();
+        throw std::runtime_error("Cannot write png header to " + filename);
+    }
+    png_init_io(pngPtr, file);
+    png_set_IHDR(pngPtr,
+                 infoPtr,
+                 width,
+                 height,
+                 8,
+                 PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT,
+                 PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(pngPtr, infoPtr);
+    png_set_filler(pngPtr, 0, PNG_FILLER_AFTER); // drop the alpha byte of every pixel
+}
+
+PngStreamWriter::~PngStreamWriter() { release(); }
+
+void PngStreamWriter::writeRows(std::uint8_t const *rgba, unsigned rows) {
+    if (!png) {
+        throw std::runtime_error("Png " + filename + " is already closed");
+    }
+    png_structp pngPtr = static_cast<png_structp>(png);
+    png_infop infoPtr = static_cast<png_infop>(info);
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        release();
+        throw std::runtime_error("Cannot write png rows to " + filename);
+    }
+    png_size_t rowBytes = png_get_image_width(pngPtr, infoPtr) * 4;
+    for (unsigned y = 0; y < rows; y++) {
+        png_write_row(pngPtr, rgba + y * rowBytes);
+    }
+    rowsWritten += rows;
+}
+
+void PngStreamWriter::finish() {
+    if (!png || rowsWritten != height) {
+        throw std::runtime_error("Png " + filename + " is missing rows");
+    }
+    png_structp pngPtr = static_cast<png_structp>(png);
+    if (setjmp(png_jmpbuf(pngPtr))) {
+        release();
+        throw std::runtime_error("Cannot finish png " + filename);
+    }
+    png_write_end(pngPtr, nullptr);
+    release();
+}
+
+void PngStreamWriter::release() {
+    if (png) {
+        png_structp pngPtr = static_cast<png_structp>(png);
+        png_infop infoPtr = static_cast<png_infop>(info);
+        png_destroy_write_struct(&pngPtr, infoPtr ? &infoPtr : nullptr);
+        png = nullptr;
+        info = nullptr;
+    }
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
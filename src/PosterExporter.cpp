@@ -0,0 +1,111 @@
+#include "PosterExporter.hpp"
+
+#include "PngStreamWriter.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+/* points the fractal at another image and viewport until destroyed */
+class TargetScope {
+public:
+    TargetScope(FractalBase &fractal, sf::Image *image, Viewport *vp) : fractal(fractal) {
+        fractal.backupAndReplacePointers(image, vp);
+    }
+    ~TargetScope() { fractal.restoreBackedUpPointers(); }
+
+    TargetScope(TargetScope const &) = delete;
+    TargetScope &operator=(TargetScope const &) = delete;
+
+private:
+    FractalBase &fractal;
+};
+
+/* the poster's antialiasing and locked color range until destroyed, then the shown ones */
+class PosterSettingsScope {
+public:
+    PosterSettingsScope(FractalBase &fractal, AntialiasParams antialiasing, ColorRange range)
+        : fractal(fractal),
+          shownAntialiasing(fractal.getAntialiasing()) {
+        fractal.setAntialiasing(antialiasing);
+        fractal.lockColorRange(range);
+    }
+    ~PosterSettingsScope() {
+        fractal.setAntialiasing(shownAntialiasing);
+        fractal.unlockColorRange();
+    }
+
+    PosterSettingsScope(PosterSettingsScope const &) = delete;
+    PosterSettingsScope &operator=(PosterSettingsScope const &) = delete;
+
+private:
+    FractalBase &fractal;
+    AntialiasParams shownAntialiasing;
+};
+
+} // namespace
+
+PosterExporter::PosterExporter(FractalBase &fractal, AntialiasParams antialiasing)
+    : fractal(fractal),
+      antialiasing(antialiasing) {}
+
+void PosterExporter::save(Viewport const &viewport,
+                          unsigned width,
+                          unsigned height,
+                          std::string const &filename) {
+    PngStreamWriter writer(filename, width, height);
+    ColorRange range = preview(viewport, width, height);
+
+    double dy = viewport.height / height;
+    unsigned stripRows = static_cast<unsigned>(std::max<std::size_t>(1, STRIP_PIXELS / width));
+    sf::Image strip({width, std::min(stripRows, height)});
+    Viewport stripVp = viewport;
+    AntialiasStats antialiased;
+
+    {
+        // whatever a strip throws, the fractal goes back to the shown image and settings
+        PosterSettingsScope settings(fractal, antialiasing, range);
+        TargetScope target(fractal, &strip, &stripVp);
+        for (unsigned y0 = 0; y0 < height; y0 += stripRows) {
+            unsigned rows = std::min(stripRows, height - y0);
+            if (rows != strip.getSize().y) {
+                strip = sf::Image({width, rows});
+            }
+            // rows y0 .. y0 + rows - 1 of the poster, same pixel spacing
+            stripVp.height = dy * rows;
+            stripVp.centerY = viewport.centerY + 0.5 * viewport.height - dy * (y0 + 0.5 * rows);
+
+            fractal.compute();
+            AntialiasStats stripStats = fractal.lastFrameStats().antialias;
+            antialiased.edgePixels += stripStats.edgePixels;
+            antialiased.pixels += stripStats.pixels;
+            antialiased.samples += stripStats.samples;
+
+            writer.writeRows(strip.getPixelsPtr(), rows);
+            std::cout << "\rRendered " << y0 + rows << "/" << height << " rows" << std::flush;
+        }
+    }
+    std::cout << std::endl;
+    writer.finish();
+    if (antialiasing.maxSamples > 0) {
+        double pixels = double(width) * height;
+        std::cout << "Antialiased " << antialiased.pixels << " of " << antialiased.edgePixels
+                  << " edge pixels with " << antialiased.samples / pixels
+                  << " extra samples per pixel" << std::endl;
+    }
+}
+
+// the whole poster at low resolution, its color range stands in for the full one
+ColorRange PosterExporter::preview(Viewport const &viewport, unsigned width, unsigned height) {
+    unsigned previewWidth = std::min(width, PREVIEW_WIDTH);
+    unsigned previewHeight =
+        std::max(1u, static_cast<unsigned>(static_cast<double>(height) * previewWidth / width));
+    sf::Image image({previewWidth, previewHeight});
+    Viewport previewVp = viewport;
+
+    fractal.unlockColorRange();
+    TargetScope target(fractal, &image, &previewVp);
+    fractal.compute();
+    return fractal.lastColorRange();
+}
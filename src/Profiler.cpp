@@ -0,0 +1,177 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event {
+    char const *name;
+    std::int64_t start; // ns since the profiler started
+    std::int64_t duration;
+};
+
+/* written only by its own thread, kept after the thread exits */
+struct ThreadData {
+    int id;
+    std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(Profiler::Counter::Count)>
+        counters{};
+    std::vector<Event> events;
+};
+
+// bounds the memory of a long session, later events are dropped, counters keep counting
+constexpr std::size_t MAX_EVENTS_PER_THREAD = std::size_t(1) << 20;
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadData>> registry;
+const auto epoch = std::chrono::steady_clock::now();
+
+std::int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                epoch)
+        .count();
+}
+
+ThreadData &threadData() {
+    thread_local ThreadData *data = [] {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::make_unique<ThreadData>());
+        registry.back()->id = static_cast<int>(registry.size()) - 1;
+        return registry.back().get();
+    }();
+    return *data;
+}
+
+} // namespace
+
+Profiler::Scope::Scope(char const *name) : name(name), start(now()) {}
+
+Profiler::Scope::~Scope() {
+    ThreadData &data = threadData();
+    if (data.events.size() < MAX_EVENTS_PER_THREAD) {
+        data.events.push_back({name, start, now() - start});
+    }
+}
+
+void Profiler::count(Counter counter, std::uint64_t n) {
+    auto &value = threadData().counters[static_cast<std::size_t>(counter)];
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+char const *Profiler::counterName(Counter counter) {
+    switch (counter) {
+    case Counter::Pixels:
+        return "pixels";
+    case Counter::Iterations:
+        return "iterations";
+    case Counter::BulbSkips:
+        return "bulb skips";
+    case Counter::PeriodicExits:
+        return "periodic exits";
+    case Counter::HintedExits:
+        return "hinted exits";
+    case Counter::ProofIterations:
+        return "proof iterations";
+    case Counter::SavedIterations:
+        return "saved iterations";
+    case Counter::SeriesSkippedIterations:
+        return "series skipped iterations";
+    case Counter::ReusedPixels:
+        return "reused pixels";
+    case Counter::CachedPixels:
+        return "cached pixels";
+    case Counter::FilledPixels:
+        return "filled pixels";
+    case Counter::DiskFilledPixels:
+        return "disk filled pixels";
+    default:
+        return "?";
+    }
+}
+
+void Profiler::report(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    struct Phase {
+        std::int64_t total = 0;
+        std::size_t calls = 0;
+    };
+    std::map<std::string, Phase> phases;
+    for (auto const &data : registry) {
+        for (Event const &event : data->events) {
+            Phase &phase = phases[event.name];
+            phase.total += event.duration;
+            phase.calls++;
+        }
+    }
+    out << "Phases (summed over threads):\n";
+    for (auto const &[name, phase] : phases) {
+        out << "  " << name << ": " << phase.total * 1e-6 << " ms in " << phase.calls
+            << " calls\n";
+    }
+
+    out << "Counters per thread:\n";
+    for (auto const &data : registry) {
+        out << "  thread " << data->id << ":";
+        for (std::size_t c = 0; c < data->counters.size(); c++) {
+            std::uint64_t value = data->counters[c].load(std::memory_order_relaxed);
+            if (value) {
+                out << " " << counterName(static_cast<Counter>(c)) << "=" << value;
+            }
+        }
+        out << "\n";
+    }
+    out << std::flush;
+}
+
+std::uint64_t Profiler::total(Counter counter) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::uint64_t sum = 0;
+    for (auto const &data : registry) {
+        sum += data->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+bool Profiler::writeChromeTrace(std::string const &path) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::ofstream out(path);
+
+    // complete events in microseconds, the counters as one sample per thread at the end
+    out << "{\"traceEvents\": [\n";
+    bool first = true;
+    auto separator = [&] {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+    std::int64_t end = now();
+    for (auto const &data : registry) {
+        separator();
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << data->id
+            << ", \"args\": {\"name\": \"thread " << data->id << "\"}}";
+        for (Event const &event : data->events) {
+            separator();
+            out << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << data->id << ", \"ts\": " << event.start * 1e-3
+                << ", \"dur\": " << event.duration * 1e-3 << "}";
+        }
+        separator();
+        out << "{\"name\": \"counters thread " << data->id
+            << "\", \"ph\": \"C\", \"pid\": 1, \"tid\": " << data->id
+            << ", \"ts\": " << end * 1e-3 << ", \"args\": {";
+        for (std::size_t c = 0; c < data->counters.size(); c++) {
+            out << (c ? ", " : "") << "\"" << counterName(static_cast<Counter>(c))
+                << "\": " << data->counters[c].load(std::memory_order_relaxed);
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
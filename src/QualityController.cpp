@@ -0,0 +1,51 @@
+#include "QualityController.hpp"
+
+#include <algorithm>
+
+QualityController::QualityController(QualityParams params) : params(params) {}
+
+QualityLevel QualityController::interactive() const {
+    QualityLevel level;
+    if (estimate <= params.frameBudget) {
+        return level;
+    }
+    // share of a full frame the budget affords
+    double affordable = params.frameBudget / estimate;
+    while (cost(level) > affordable && level.scale * 0.5 >= params.minScale) {
+        level.scale *= 0.5;
+    }
+    if (cost(level) > affordable) {
+        level.iterationScale = std::max(params.minIterationScale,
+                                        affordable / (level.scale * level.scale));
+    }
+    return level;
+}
+
+void QualityController::record(QualityLevel level, double seconds) {
+    // taken as the full frame scaled down, the feedback corrects what the model misses: fewer
+    // iterations save less than their share where most pixels escape early
+    double fullSeconds = seconds / cost(level);
+    estimate = estimate > 0.0 ? estimate + SMOOTHING * (fullSeconds - estimate) : fullSeconds;
+    lastSeconds = seconds;
+}
+
+void QualityController::recordCancelled(QualityLevel level, double seconds) {
+    estimate = std::max(estimate, seconds / cost(level));
+}
+
+std::vector<QualityLevel> QualityController::refinement(QualityLevel from) const {
+    std::vector<QualityLevel> levels;
+    QualityLevel level = from;
+    while (!level.full()) {
+        level.scale = std::min(1.0, level.scale * 2.0);
+        if (level.scale >= 1.0) {
+            level.iterationScale = 1.0;
+        }
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+double QualityController::cost(QualityLevel level) {
+    return level.scale * level.scale * level.iterationScale;
+}
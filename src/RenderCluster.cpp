@@ -0,0 +1,389 @@
+#include "RenderCluster.hpp"
+
+#include "TileProtocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+RenderCluster::RenderCluster(std::vector<std::string> const &workerCommands,
+                             ConfigLoader::FractalParams const &params)
+    : workers(workerCommands.size()),
+      params(params) {
+    if (workerCommands.empty()) {
+        throw std::invalid_argument("A render cluster needs at least one worker");
+    }
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        workers[i].command = workerCommands[i];
+        start(workers[i]);
+    }
+}
+
+RenderCluster::~RenderCluster() {
+    for (Worker &worker : workers) {
+        stop(worker);
+    }
+}
+
+std::vector<float> RenderCluster::render(Viewport const &viewport,
+                                         unsigned width,
+                                         unsigned height,
+                                         std::ostream &log) {
+    std::vector<float> field(std::size_t(width) * height);
+    render(
+        viewport,
+        width,
+        height,
+        [&](unsigned y0, unsigned rows, float const *band) {
+            std::copy(band,
+                      band + std::size_t(width) * rows,
+                      field.begin() + std::size_t(y0) * width);
+        },
+        log);
+    return field;
+}
+
+void RenderCluster::render(Viewport const &viewport,
+                           unsigned width,
+                           unsigned height,
+                           std::function<void(unsigned, unsigned, float const *)> const &rows,
+                           std::ostream &log,
+                           FieldFile *fieldFile) {
+    if (width == 0 || height == 0) {
+        throw std::invalid_argument("Empty picture");
+    }
+    if (fieldFile && (fieldFile->header().width != width ||
+                      fieldFile->header().height != height ||
+                      fieldFile->header().tileSize != TILE_SIZE)) {
+        throw std::invalid_argument("Field file of another picture");
+    }
+    field = fieldFile;
+    renderVp = viewport;
+    renderWidth = width;
+    renderHeight = height;
+    stats = {};
+    stats.tilesPerWorker.assign(workers.size(), 0);
+    finishedSeconds = 0.0;
+    finishedTiles = 0;
+
+    std::size_t tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    std::size_t tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    tiles.clear();
+    for (std::size_t ty = 0; ty < tilesY; ty++) {
+        for (std::size_t tx = 0; tx < tilesX; tx++) {
+            Tile tile;
+            tile.x0 = static_cast<unsigned>(tx * TILE_SIZE);
+            tile.y0 = static_cast<unsigned>(ty * TILE_SIZE);
+            tile.x1 = std::min<unsigned>(tile.x0 + TILE_SIZE, width);
+            tile.y1 = std::min<unsigned>(tile.y0 + TILE_SIZE, height);
+            tiles.push_back(tile);
+        }
+    }
+    queue.clear();
+    jobTiles.clear(); // answers to jobs of an earlier render are dropped
+    bands.assign(tilesY, {});
+    bandTilesLeft.assign(tilesY, tilesX);
+    for (std::size_t i = 0; field && i < tiles.size(); i++) {
+        if (field->tileDone(i)) {
+            store(i, field->tile(i), TILE_SIZE);
+            stats.resumedTiles++;
+        }
+    }
+
+    // bands queued ahead of the next one handed out, enough to keep every worker busy
+    std::size_t bandsAhead = 2 + workers.size() * JOBS_PER_WORKER / tilesX;
+    std::size_t nextBand = 0, queuedBands = 0;
+    while (nextBand < tilesY) {
+        for (; queuedBands < tilesY && queuedBands < nextBand + bandsAhead; queuedBands++) {
+            for (std::size_t tx = 0; tx < tilesX; tx++) {
+                if (!tiles[queuedBands * tilesX + tx].done) {
+                    queue.push_back(queuedBands * tilesX + tx);
+                }
+            }
+        }
+
+        // idle workers take the queue, once it is empty they race the slow tiles
+        for (std::size_t w = 0; w < workers.size(); w++) {
+            while (workers[w].alive && workers[w].jobs.size() < JOBS_PER_WORKER) {
+                if (!queue.empty()) {
+                    std::size_t tile = queue.front();
+                    queue.pop_front();
+                    if (!send(w, tile, log)) {
+                        queue.push_front(tile);
+                    }
+                    continue;
+                }
+                long slow = slowTile(w);
+                if (slow < 0) {
+                    break;
+                }
+                if (send(w, static_cast<std::size_t>(slow), log)) {
+                    stats.duplicatedTiles++;
+                }
+            }
+        }
+        if (liveWorkers() == 0) {
+            throw std::runtime_error("No render workers left");
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<std::size_t> owners;
+        for (std::size_t w = 0; w < workers.size(); w++) {
+            if (workers[w].alive) {
+                fds.push_back({workers[w].fd, POLLIN, 0});
+                owners.push_back(w);
+            }
+        }
+        if (::poll(fds.data(), fds.size(), POLL_MILLISECONDS) < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Polling workers failed: ") +
+                                     std::strerror(errno));
+        }
+        for (std::size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                receive(owners[i], log);
+            }
+        }
+
+        while (nextBand < tilesY && bandTilesLeft[nextBand] == 0) {
+            if (field) {
+                field->sync(); // the band's tiles are on disk before it is handed out
+            }
+            unsigned y0 = static_cast<unsigned>(nextBand * TILE_SIZE);
+            unsigned count = std::min(TILE_SIZE, height - y0);
+            rows(y0, count, bands[nextBand].data());
+            std::vector<float>().swap(bands[nextBand]);
+            nextBand++;
+            log << "\rRendered " << y0 + count << "/" << height << " rows" << std::flush;
+        }
+    }
+    log << std::endl;
+}
+
+std::size_t RenderCluster::liveWorkers() const {
+    return std::count_if(
+        workers.begin(), workers.end(), [](Worker const &worker) { return worker.alive; });
+}
+
+void RenderCluster::start(Worker &worker) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        throw std::runtime_error(std::string("Cannot create worker socket: ") +
+                                 std::strerror(errno));
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        throw std::runtime_error(std::string("Cannot start worker: ") + std::strerror(errno));
+    }
+    if (pid == 0) {
+        // dup2 clears close-on-exec, the sockets of the other workers stay closed
+        ::dup2(fds[1], STDIN_FILENO);
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::execl("/bin/sh", "sh", "-c", worker.command.c_str(), static_cast<char *>(nullptr));
+        ::_exit(127);
+    }
+    ::close(fds[1]);
+    worker.pid = pid;
+    worker.fd = fds[0];
+    worker.alive = true;
+    worker.lastAnswer = Clock::now();
+}
+
+void RenderCluster::stop(Worker &worker) {
+    if (worker.fd >= 0) {
+        ::close(worker.fd);
+        worker.fd = -1;
+    }
+    if (worker.pid > 0) {
+        ::kill(worker.pid, SIGTERM);
+        ::waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    }
+    worker.alive = false;
+}
+
+void RenderCluster::lose(std::size_t w, std::string const &why, std::ostream &log) {
+    Worker &worker = workers[w];
+    log << "\nWorker " << w << " (" << worker.command << ") lost: " << why << std::endl;
+    stats.lostWorkers++;
+    stop(worker);
+    std::deque<Job> jobs;
+    jobs.swap(worker.jobs);
+    for (Job const &job : jobs) {
+        auto it = jobTiles.find(job.id);
+        if (it == jobTiles.end()) {
+            continue;
+        }
+        std::size_t tile = it->second;
+        jobTiles.erase(it);
+        tiles[tile].copies--;
+        if (!tiles[tile].done && tiles[tile].copies == 0) {
+            failed(tile, why);
+        }
+    }
+}
+
+bool RenderCluster::send(std::size_t w, std::size_t tile, std::ostream &log) {
+    Worker &worker = workers[w];
+    tileprotocol::Job job;
+    job.id = nextJobId++;
+    job.fractal = params;
+    job.viewport = renderVp;
+    job.width = renderWidth;
+    job.height = renderHeight;
+    job.x0 = tiles[tile].x0;
+    job.y0 = tiles[tile].y0;
+    job.x1 = tiles[tile].x1;
+    job.y1 = tiles[tile].y1;
+    try {
+        tileprotocol::writeMessage(worker.fd, tileprotocol::MessageType::Job, encodeJob(job));
+    } catch (std::runtime_error const &error) {
+        lose(w, error.what(), log);
+        return false;
+    }
+    jobTiles[job.id] = tile;
+    tiles[tile].copies++;
+    worker.jobs.push_back({job.id, Clock::now()});
+    return true;
+}
+
+void RenderCluster::receive(std::size_t w, std::ostream &log) {
+    Worker &worker = workers[w];
+    if (!worker.alive) {
+        return; // lost since the poll
+    }
+    tileprotocol::Message message;
+    tileprotocol::Result result;
+    std::string error;
+    try {
+        if (!tileprotocol::readMessage(worker.fd, message)) {
+            lose(w, "exited", log);
+            return;
+        }
+        if (message.type == tileprotocol::MessageType::Result) {
+            result = tileprotocol::decodeResult(message.payload);
+        } else if (message.type == tileprotocol::MessageType::Error) {
+            tileprotocol::decodeError(message.payload, result.id, error);
+        } else {
+            throw std::runtime_error("Unexpected message");
+        }
+    } catch (std::runtime_error const &e) {
+        lose(w, e.what(), log);
+        return;
+    }
+    // a worker answers its jobs in order
+    if (worker.jobs.empty() || worker.jobs.front().id != result.id) {
+        lose(w, "answered a job it was not working on", log);
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    double seconds =
+        std::chrono::duration<double>(now - std::max(worker.jobs.front().sent, worker.lastAnswer))
+            .count();
+    worker.jobs.pop_front();
+    worker.lastAnswer = now;
+
+    auto it = jobTiles.find(result.id);
+    if (it == jobTiles.end()) {
+        return; // a job of an earlier render
+    }
+    std::size_t index = it->second;
+    jobTiles.erase(it);
+    Tile &tile = tiles[index];
+    tile.copies--;
+    if (!error.empty()) {
+        log << "\nWorker " << w << " failed a tile: " << error << std::endl;
+        if (!tile.done && tile.copies == 0) {
+            failed(index, error);
+        }
+        return;
+    }
+    if (tile.done) {
+        return; // the other copy of a slow tile was faster
+    }
+    std::size_t tileWidth = tile.x1 - tile.x0;
+    if (result.field.size() != tileWidth * (tile.y1 - tile.y0)) {
+        if (tile.copies == 0) {
+            failed(index, "tile of the wrong size");
+        }
+        lose(w, "sent a tile of the wrong size", log);
+        return;
+    }
+
+    stats.tiles++;
+    stats.tilesPerWorker[w]++;
+    stats.compressedBytes += message.payload.size();
+    finishedSeconds += seconds;
+    finishedTiles++;
+    store(index, result.field.data(), tileWidth);
+    if (field) {
+        field->writeTile(index, result.field.data());
+    }
+}
+
+void RenderCluster::store(std::size_t index, float const *values, std::size_t stride) {
+    Tile &tile = tiles[index];
+    tile.done = true;
+    std::size_t band = tile.y0 / TILE_SIZE;
+    if (bands[band].empty()) {
+        unsigned bandRows = std::min(TILE_SIZE, renderHeight - tile.y0);
+        bands[band].resize(std::size_t(renderWidth) * bandRows);
+    }
+    for (unsigned y = tile.y0; y < tile.y1; y++) {
+        float const *src = values + std::size_t(y - tile.y0) * stride;
+        std::copy(src,
+                  src + (tile.x1 - tile.x0),
+                  bands[band].begin() + std::size_t(y - tile.y0) * renderWidth + tile.x0);
+    }
+    bandTilesLeft[band]--;
+}
+
+void RenderCluster::failed(std::size_t index, std::string const &why) {
+    Tile &tile = tiles[index];
+    tile.failures++;
+    stats.failedTiles++;
+    if (tile.failures >= MAX_ATTEMPTS) {
+        throw std::runtime_error("Tile at " + std::to_string(tile.x0) + ", " +
+                                 std::to_string(tile.y0) + " failed " +
+                                 std::to_string(tile.failures) + " times, last: " + why);
+    }
+    queue.push_front(index);
+}
+
+// the jobs queued behind a slow one wait as long, so every job counts from when it was sent
+long RenderCluster::slowTile(std::size_t w) const {
+    if (finishedTiles == 0) {
+        return -1;
+    }
+    double threshold =
+        std::max(SLOW_TILE_MIN_SECONDS, SLOW_TILE_FACTOR * finishedSeconds / finishedTiles);
+    Clock::time_point now = Clock::now();
+    long slowest = -1;
+    double slowestSeconds = threshold;
+    for (std::size_t other = 0; other < workers.size(); other++) {
+        if (other == w) {
+            continue;
+        }
+        for (Job const &job : workers[other].jobs) {
+            auto it = jobTiles.find(job.id);
+            if (it == jobTiles.end()) {
+                continue;
+            }
+            Tile const &tile = tiles[it->second];
+            double seconds = std::chrono::duration<double>(now - job.sent).count();
+            if (!tile.done && tile.copies == 1 && seconds > slowestSeconds) {
+                slowest = static_cast<long>(it->second);
+                slowestSeconds = seconds;
+            }
+        }
+    }
+    return slowest;
+}
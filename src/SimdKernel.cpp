@@ -0,0 +1,130 @@
+#include "SimdKernel.hpp"
+
+#include "EscapeTime.hpp"
+#include "Profiler.hpp"
+
+#include <vector>
+
+bool attractingCycleOutOfLine(
+    float cr, float ci, float zr, float zi, int period, std::uint64_t &cost) {
+    return attractingCycle(cr, ci, zr, zi, period, cost);
+}
+
+bool attractingCycleOutOfLine(
+    double cr, double ci, double zr, double zi, int period, std::uint64_t &cost) {
+    return attractingCycle(cr, ci, zr, zi, period, cost);
+}
+
+SimdKernel::SimdKernel(int maxIterations) : maxIterations(maxIterations) {
+    setIsa(detectIsa());
+}
+
+void SimdKernel::setIsa(Isa isa) {
+    selectedIsa = isa;
+    switch (isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::SSE2:
+        batch = escapeTimeBatchSse2;
+        batchFloat = escapeTimeBatchSse2Float;
+        break;
+    case Isa::AVX2:
+        batch = escapeTimeBatchAvx2;
+        batchFloat = escapeTimeBatchAvx2Float;
+        break;
+    case Isa::AVX512:
+        batch = escapeTimeBatchAvx512;
+        batchFloat = escapeTimeBatchAvx512Float;
+        break;
+#endif
+    default:
+        selectedIsa = Isa::Scalar;
+        batch = nullptr;
+        batchFloat = nullptr;
+        break;
+    }
+}
+
+SimdKernel::Isa SimdKernel::detectIsa() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Isa::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return Isa::SSE2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+const char *SimdKernel::isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE2:
+        return "SSE2";
+    case Isa::AVX2:
+        return "AVX2";
+    case Isa::AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+void SimdKernel::computePoints(const double *cr,
+                               const double *ci,
+                               std::size_t count,
+                               double *out,
+                               EscapeState *states) const {
+    PROFILE_COUNT(Pixels, count);
+    if (!batch) {
+        int period = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            out[i] = escapeTime(
+                cr[i], ci[i], maxIterations, states ? states + i : nullptr, &period);
+        }
+        return;
+    }
+    runBatch(batch, cr, ci, count, out, states);
+}
+
+void SimdKernel::computePointsFloat(const double *cr,
+                                    const double *ci,
+                                    std::size_t count,
+                                    double *out,
+                                    EscapeState *states) const {
+    if (maxIterations > FLOAT_MAX_ITERATIONS) {
+        computePoints(cr, ci, count, out, states);
+        return;
+    }
+    PROFILE_COUNT(Pixels, count);
+    if (!batchFloat) {
+        int period = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            out[i] = escapeTime(static_cast<float>(cr[i]),
+                                static_cast<float>(ci[i]),
+                                maxIterations,
+                                states ? states + i : nullptr,
+                                &period);
+        }
+        return;
+    }
+    runBatch(batchFloat, cr, ci, count, out, states);
+}
+
+void SimdKernel::runBatch(BatchFn fn,
+                          const double *cr,
+                          const double *ci,
+                          std::size_t count,
+                          double *out,
+                          EscapeState *states) const {
+    // one batch for the whole input, the kernel refills lanes so only the very end drains
+    std::vector<int> iterations(count);
+    std::vector<double> modulus2(count);
+    fn(cr, ci, count, maxIterations, iterations.data(), modulus2.data(), states);
+    for (std::size_t i = 0; i < count; i++) {
+        out[i] = iterations[i] < 0 ? -1.0 : smoothIterationCount(iterations[i], modulus2[i]);
+    }
+}
@@ -0,0 +1,78 @@
+#include "SimdKernel.hpp"
+#include "SimdKernelImpl.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Ops {
+    using T = double;
+    using V = __m256d;
+    using M = __m256d;
+    static constexpr std::size_t lanes = 4;
+
+    static V set1(double x) { return _mm256_set1_pd(x); }
+    static V load(const double *p) { return _mm256_load_pd(p); }
+    static void store(double *p, V v) { _mm256_store_pd(p, v); }
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+    static M cmpLt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M cmpLe(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static M cmpEq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static M maskAnd(M a, M b) { return _mm256_and_pd(a, b); }
+    static M maskOr(M a, M b) { return _mm256_or_pd(a, b); }
+    static M maskAndNot(M a, M b) { return _mm256_andnot_pd(a, b); } // ~a & b
+    static M maskNot(M a) { return _mm256_xor_pd(a, _mm256_castsi256_pd(_mm256_set1_epi32(-1))); }
+    static V select(M m, V a, V b) { return _mm256_blendv_pd(a, b, m); }
+    static bool any(M m) { return _mm256_movemask_pd(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm256_movemask_pd(m)); }
+};
+
+struct Avx2FloatOps {
+    using T = float;
+    using V = __m256;
+    using M = __m256;
+    static constexpr std::size_t lanes = 8;
+
+    static V set1(float x) { return _mm256_set1_ps(x); }
+    static V load(const float *p) { return _mm256_load_ps(p); }
+    static void store(float *p, V v) { _mm256_store_ps(p, v); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V max(V a, V b) { return _mm256_max_ps(a, b); }
+    static M cmpLt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M cmpLe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static M cmpEq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static M maskAnd(M a, M b) { return _mm256_and_ps(a, b); }
+    static M maskOr(M a, M b) { return _mm256_or_ps(a, b); }
+    static M maskAndNot(M a, M b) { return _mm256_andnot_ps(a, b); } // ~a & b
+    static M maskNot(M a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+    static V select(M m, V a, V b) { return _mm256_blendv_ps(a, b, m); }
+    static bool any(M m) { return _mm256_movemask_ps(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm256_movemask_ps(m)); }
+};
+
+} // namespace
+
+void escapeTimeBatchAvx2(const double *cr,
+                         const double *ci,
+                         std::size_t count,
+                         int maxIterations,
+                         int *iterations,
+                         double *modulus2,
+                         EscapeState *states) {
+    escapeTimeBatch<Avx2Ops>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
+
+void escapeTimeBatchAvx2Float(const double *cr,
+                              const double *ci,
+                              std::size_t count,
+                              int maxIterations,
+                              int *iterations,
+                              double *modulus2,
+                              EscapeState *states) {
+    escapeTimeBatch<Avx2FloatOps>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
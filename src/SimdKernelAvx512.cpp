@@ -0,0 +1,78 @@
+#include "SimdKernel.hpp"
+#include "SimdKernelImpl.hpp"
+
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512Ops {
+    using T = double;
+    using V = __m512d;
+    using M = __mmask8;
+    static constexpr std::size_t lanes = 8;
+
+    static V set1(double x) { return _mm512_set1_pd(x); }
+    static V load(const double *p) { return _mm512_load_pd(p); }
+    static void store(double *p, V v) { _mm512_store_pd(p, v); }
+    static V add(V a, V b) { return _mm512_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+    static V max(V a, V b) { return _mm512_max_pd(a, b); }
+    static M cmpLt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static M cmpLe(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+    static M cmpEq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static M maskAnd(M a, M b) { return a & b; }
+    static M maskOr(M a, M b) { return a | b; }
+    static M maskAndNot(M a, M b) { return static_cast<M>(~a & b); }
+    static M maskNot(M a) { return static_cast<M>(~a); }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, a, b); }
+    static bool any(M m) { return m != 0; }
+    static unsigned bits(M m) { return m; }
+};
+
+struct Avx512FloatOps {
+    using T = float;
+    using V = __m512;
+    using M = __mmask16;
+    static constexpr std::size_t lanes = 16;
+
+    static V set1(float x) { return _mm512_set1_ps(x); }
+    static V load(const float *p) { return _mm512_load_ps(p); }
+    static void store(float *p, V v) { _mm512_store_ps(p, v); }
+    static V add(V a, V b) { return _mm512_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+    static V max(V a, V b) { return _mm512_max_ps(a, b); }
+    static M cmpLt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M cmpLe(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static M cmpEq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static M maskAnd(M a, M b) { return a & b; }
+    static M maskOr(M a, M b) { return a | b; }
+    static M maskAndNot(M a, M b) { return static_cast<M>(~a & b); }
+    static M maskNot(M a) { return static_cast<M>(~a); }
+    static V select(M m, V a, V b) { return _mm512_mask_blend_ps(m, a, b); }
+    static bool any(M m) { return m != 0; }
+    static unsigned bits(M m) { return m; }
+};
+
+} // namespace
+
+void escapeTimeBatchAvx512(const double *cr,
+                           const double *ci,
+                           std::size_t count,
+                           int maxIterations,
+                           int *iterations,
+                           double *modulus2,
+                           EscapeState *states) {
+    escapeTimeBatch<Avx512Ops>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
+
+void escapeTimeBatchAvx512Float(const double *cr,
+                                const double *ci,
+                                std::size_t count,
+                                int maxIterations,
+                                int *iterations,
+                                double *modulus2,
+                                EscapeState *states) {
+    escapeTimeBatch<Avx512FloatOps>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
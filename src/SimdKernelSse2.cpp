@@ -0,0 +1,78 @@
+#include "SimdKernel.hpp"
+#include "SimdKernelImpl.hpp"
+
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Ops {
+    using T = double;
+    using V = __m128d;
+    using M = __m128d;
+    static constexpr std::size_t lanes = 2;
+
+    static V set1(double x) { return _mm_set1_pd(x); }
+    static V load(const double *p) { return _mm_load_pd(p); }
+    static void store(double *p, V v) { _mm_store_pd(p, v); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+    static M cmpLt(V a, V b) { return _mm_cmplt_pd(a, b); }
+    static M cmpLe(V a, V b) { return _mm_cmple_pd(a, b); }
+    static M cmpEq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+    static M maskAnd(M a, M b) { return _mm_and_pd(a, b); }
+    static M maskOr(M a, M b) { return _mm_or_pd(a, b); }
+    static M maskAndNot(M a, M b) { return _mm_andnot_pd(a, b); } // ~a & b
+    static M maskNot(M a) { return _mm_xor_pd(a, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+    static V select(M m, V a, V b) { return _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a)); }
+    static bool any(M m) { return _mm_movemask_pd(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm_movemask_pd(m)); }
+};
+
+struct Sse2FloatOps {
+    using T = float;
+    using V = __m128;
+    using M = __m128;
+    static constexpr std::size_t lanes = 4;
+
+    static V set1(float x) { return _mm_set1_ps(x); }
+    static V load(const float *p) { return _mm_load_ps(p); }
+    static void store(float *p, V v) { _mm_store_ps(p, v); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+    static M cmpLt(V a, V b) { return _mm_cmplt_ps(a, b); }
+    static M cmpLe(V a, V b) { return _mm_cmple_ps(a, b); }
+    static M cmpEq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+    static M maskAnd(M a, M b) { return _mm_and_ps(a, b); }
+    static M maskOr(M a, M b) { return _mm_or_ps(a, b); }
+    static M maskAndNot(M a, M b) { return _mm_andnot_ps(a, b); } // ~a & b
+    static M maskNot(M a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+    static V select(M m, V a, V b) { return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a)); }
+    static bool any(M m) { return _mm_movemask_ps(m) != 0; }
+    static unsigned bits(M m) { return static_cast<unsigned>(_mm_movemask_ps(m)); }
+};
+
+} // namespace
+
+void escapeTimeBatchSse2(const double *cr,
+                         const double *ci,
+                         std::size_t count,
+                         int maxIterations,
+                         int *iterations,
+                         double *modulus2,
+                         EscapeState *states) {
+    escapeTimeBatch<Sse2Ops>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
+
+void escapeTimeBatchSse2Float(const double *cr,
+                              const double *ci,
+                              std::size_t count,
+                              int maxIterations,
+                              int *iterations,
+                              double *modulus2,
+                              EscapeState *states) {
+    escapeTimeBatch<Sse2FloatOps>(cr, ci, count, maxIterations, iterations, modulus2, states);
+}
@@ -0,0 +1,81 @@
+#include "TileCache.hpp"
+
+#include <cmath>
+
+std::size_t TileKeyHash::operator()(TileKey const &key) const {
+    std::uint64_t hash = key.params;
+    for (std::int64_t value : {key.levelX, key.levelY, key.tileX, key.tileY}) {
+        hash ^= static_cast<std::uint64_t>(value) + 0x9e3779b97f4a7c15ull + (hash << 6) +
+                (hash >> 2);
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+TileCache::TileCache(std::size_t budgetBytes,
+                     std::string const &spillDirectory,
+                     std::size_t spillBytes)
+    : budgetBytes(budgetBytes) {
+    if (!spillDirectory.empty()) {
+        store = std::make_unique<TileStore>(spillDirectory, TILE_SAMPLES, spillBytes);
+    }
+}
+
+bool TileCache::find(TileKey const &key, Tile &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        out = it->second->second;
+        return true;
+    }
+    if (!store) {
+        return false;
+    }
+    out.resize(TILE_SAMPLES);
+    if (!store->read(key, out.data())) {
+        return false;
+    }
+    lru.emplace_front(key, out);
+    index[key] = lru.begin();
+    evictOverBudget();
+    return true;
+}
+
+void TileCache::insert(TileKey const &key, Tile const &tile) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        Tile cached(TILE_SAMPLES, std::numeric_limits<double>::quiet_NaN());
+        if (store) {
+            store->read(key, cached.data());
+        }
+        lru.emplace_front(key, std::move(cached));
+        it = index.emplace(key, lru.begin()).first;
+    } else {
+        lru.splice(lru.begin(), lru, it->second);
+    }
+
+    Tile &cached = it->second->second;
+    for (std::size_t i = 0; i < TILE_SAMPLES; i++) {
+        if (!std::isnan(tile[i])) {
+            cached[i] = tile[i];
+        }
+    }
+    evictOverBudget();
+}
+
+std::size_t TileCache::sizeBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size() * TILE_SAMPLES * sizeof(double);
+}
+
+void TileCache::evictOverBudget() {
+    while (!lru.empty() && lru.size() * TILE_SAMPLES * sizeof(double) > budgetBytes) {
+        auto &[key, tile] = lru.back();
+        if (store) {
+            store->write(key, tile.data());
+        }
+        index.erase(key);
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,307 @@
+#include "TileProtocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace tileprotocol {
+
+namespace {
+
+constexpr std::uint32_t MAGIC = 0x46524354; // "FRCT"
+constexpr std::size_t HEADER_SIZE = 9;      // magic, type, payload size
+/* larger than any tile, a corrupt size fails instead of allocating gigabytes */
+constexpr std::uint32_t MAX_PAYLOAD = std::uint32_t(1) << 28;
+
+class Writer {
+public:
+    void u8(std::uint8_t v) { bytes.push_back(v); }
+    void u32(std::uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            bytes.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+    }
+    void u64(std::uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            bytes.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+        }
+    }
+    void f64(double v) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u64(bits);
+    }
+    void string(std::string const &s) {
+        u32(static_cast<std::uint32_t>(s.size()));
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+
+    std::vector<std::uint8_t> bytes;
+};
+
+class Reader {
+public:
+    explicit Reader(std::vector<std::uint8_t> const &bytes) : bytes(bytes) {}
+
+    std::uint8_t u8() {
+        need(1);
+        return bytes[pos++];
+    }
+    std::uint32_t u32() {
+        need(4);
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            v |= std::uint32_t(bytes[pos++]) << (8 * i);
+        }
+        return v;
+    }
+    std::uint64_t u64() {
+        need(8);
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; i++) {
+            v |= std::uint64_t(bytes[pos++]) << (8 * i);
+        }
+        return v;
+    }
+    double f64() {
+        std::uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string string() {
+        std::uint32_t size = u32();
+        need(size);
+        std::string s(bytes.begin() + pos, bytes.begin() + pos + size);
+        pos += size;
+        return s;
+    }
+    std::uint8_t const *rest(std::size_t &size) const {
+        size = bytes.size() - pos;
+        return bytes.data() + pos;
+    }
+
+private:
+    void need(std::size_t size) const {
+        if (bytes.size() - pos < size) {
+            throw std::runtime_error("Truncated tile message");
+        }
+    }
+
+    std::vector<std::uint8_t> const &bytes;
+    std::size_t pos = 0;
+};
+
+// enough digits that the center parses back to the same 1024 bit value
+std::string exact(HPReal const &x) {
+    return x.str(std::numeric_limits<HPReal>::max_digits10, std::ios_base::scientific);
+}
+
+// false at the end of the stream before the first byte
+bool readFully(int fd, std::uint8_t *data, std::size_t size) {
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::read(fd, data + done, size - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == ECONNRESET) {
+            n = 0; // the other end exited with our data unread
+        }
+        if (n < 0) {
+            throw std::runtime_error(std::string("Tile stream read failed: ") +
+                                     std::strerror(errno));
+        }
+        if (n == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw std::runtime_error("Tile stream ended inside a message");
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+void writeFully(int fd, std::uint8_t const *data, std::size_t size) {
+    bool socket = true;
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = socket ? ::send(fd, data + done, size - done, MSG_NOSIGNAL)
+                           : ::write(fd, data + done, size - done);
+        if (n < 0 && errno == ENOTSOCK) {
+            socket = false;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw std::runtime_error(std::string("Tile stream write failed: ") +
+                                     std::strerror(errno));
+        }
+        done += static_cast<std::size_t>(n);
+    }
+}
+
+} // namespace
+
+std::vector<std::uint8_t> encodeJob(Job const &job) {
+    Writer w;
+    w.u32(job.id);
+    w.string(job.fractal.name);
+    w.u32(job.fractal.power);
+    w.f64(job.fractal.juliaCr);
+    w.f64(job.fractal.juliaCi);
+    w.u8(job.fractal.doubleDoubleDeepZoom ? 1 : 0);
+    w.u8(job.fractal.distanceEstimation ? 1 : 0);
+    w.u32(static_cast<std::uint32_t>(job.fractal.maxIterations));
+    w.u32(static_cast<std::uint32_t>(job.fractal.iterationsPerZoomDecade));
+    w.string(exact(job.viewport.centerX));
+    w.string(exact(job.viewport.centerY));
+    w.f64(job.viewport.width);
+    w.f64(job.viewport.height);
+    for (std::uint32_t v : {job.width, job.height, job.x0, job.y0, job.x1, job.y1}) {
+        w.u32(v);
+    }
+    return std::move(w.bytes);
+}
+
+Job decodeJob(std::vector<std::uint8_t> const &payload) {
+    Reader r(payload);
+    Job job;
+    job.id = r.u32();
+    job.fractal.name = r.string();
+    job.fractal.power = r.u32();
+    job.fractal.juliaCr = r.f64();
+    job.fractal.juliaCi = r.f64();
+    job.fractal.doubleDoubleDeepZoom = r.u8() != 0;
+    job.fractal.distanceEstimation = r.u8() != 0;
+    job.fractal.maxIterations = static_cast<int>(r.u32());
+    job.fractal.iterationsPerZoomDecade = static_cast<int>(r.u32());
+    job.viewport.centerX = HPReal(r.string());
+    job.viewport.centerY = HPReal(r.string());
+    job.viewport.width = r.f64();
+    job.viewport.height = r.f64();
+    job.width = r.u32();
+    job.height = r.u32();
+    job.x0 = r.u32();
+    job.y0 = r.u32();
+    job.x1 = r.u32();
+    job.y1 = r.u32();
+    return job;
+}
+
+// byte k of every value together. Only the sign, exponent and high mantissa bytes are
+// deflated, the low mantissa bytes are close to noise and would cost most of the time
+std::vector<std::uint8_t> encodeResult(Result const &result) {
+    std::size_t count = result.field.size();
+    std::vector<std::uint8_t> shuffled(4 * count);
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &result.field[i], sizeof(bits));
+        for (std::size_t k = 0; k < 4; k++) {
+            shuffled[k * count + i] = static_cast<std::uint8_t>(bits >> (8 * k));
+        }
+    }
+    std::uint8_t const *low = shuffled.data();
+    std::uint8_t const *high = shuffled.data() + 2 * count;
+
+    std::vector<std::uint8_t> packed(compressBound(2 * count));
+    uLongf packedSize = packed.size();
+    if (compress2(packed.data(), &packedSize, high, 2 * count, Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("Cannot compress tile");
+    }
+
+    Writer w;
+    w.u32(result.id);
+    w.u32(static_cast<std::uint32_t>(count));
+    w.u32(static_cast<std::uint32_t>(packedSize));
+    w.bytes.insert(w.bytes.end(), packed.begin(), packed.begin() + packedSize);
+    w.bytes.insert(w.bytes.end(), low, low + 2 * count);
+    return std::move(w.bytes);
+}
+
+Result decodeResult(std::vector<std::uint8_t> const &payload) {
+    Reader r(payload);
+    Result result;
+    result.id = r.u32();
+    std::size_t count = r.u32();
+    std::size_t packedSize = r.u32();
+    std::size_t restSize;
+    std::uint8_t const *packed = r.rest(restSize);
+    if (count > MAX_PAYLOAD / 4 || restSize != packedSize + 2 * count) {
+        throw std::runtime_error("Corrupt tile");
+    }
+    std::vector<std::uint8_t> shuffled(4 * count);
+    std::copy(packed + packedSize, packed + restSize, shuffled.begin());
+    uLongf size = 2 * count;
+    int status = uncompress(shuffled.data() + 2 * count, &size, packed, packedSize);
+    if (status != Z_OK || size != 2 * count) {
+        throw std::runtime_error("Corrupt tile");
+    }
+    result.field.resize(count);
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint32_t bits = 0;
+        for (std::size_t k = 0; k < 4; k++) {
+            bits |= std::uint32_t(shuffled[k * count + i]) << (8 * k);
+        }
+        std::memcpy(&result.field[i], &bits, sizeof(bits));
+    }
+    return result;
+}
+
+std::vector<std::uint8_t> encodeError(std::uint32_t id, std::string const &what) {
+    Writer w;
+    w.u32(id);
+    w.string(what);
+    return std::move(w.bytes);
+}
+
+void decodeError(std::vector<std::uint8_t> const &payload, std::uint32_t &id, std::string &what) {
+    Reader r(payload);
+    id = r.u32();
+    what = r.string();
+}
+
+bool readMessage(int fd, Message &message) {
+    std::uint8_t header[HEADER_SIZE];
+    if (!readFully(fd, header, HEADER_SIZE)) {
+        return false;
+    }
+    std::vector<std::uint8_t> headerBytes(header, header + HEADER_SIZE);
+    Reader r(headerBytes);
+    if (r.u32() != MAGIC) {
+        throw std::runtime_error("Not a tile protocol stream");
+    }
+    message.type = static_cast<MessageType>(r.u8());
+    std::uint32_t size = r.u32();
+    if (size > MAX_PAYLOAD) {
+        throw std::runtime_error("Tile message too large");
+    }
+    message.payload.resize(size);
+    if (size > 0 && !readFully(fd, message.payload.data(), size)) {
+        throw std::runtime_error("Tile stream ended inside a message");
+    }
+    return true;
+}
+
+void writeMessage(int fd, MessageType type, std::vector<std::uint8_t> const &payload) {
+    if (payload.size() > MAX_PAYLOAD) {
+        throw std::runtime_error("Tile message too large");
+    }
+    Writer w;
+    w.u32(MAGIC);
+    w.u8(static_cast<std::uint8_t>(type));
+    w.u32(static_cast<std::uint32_t>(payload.size()));
+    w.bytes.insert(w.bytes.end(), payload.begin(), payload.end());
+    writeFully(fd, w.bytes.data(), w.bytes.size());
+}
+
+} // namespace tileprotocol
@@ -0,0 +1,182 @@
+#include "TileScheduler.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <omp.h>
+
+namespace {
+
+// interleaves the bits of x and y, neighbouring tiles get nearby codes
+std::uint64_t mortonCode(std::uint32_t x, std::uint32_t y) {
+    auto spread = [](std::uint64_t v) {
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+TileScheduler::TileScheduler(std::size_t width, std::size_t height)
+    : TileScheduler(width, height, {{0, 0, width, height, 0.0}}) {}
+
+// tiles clipped to a region keep the frame's tile grid and its Morton order
+TileScheduler::TileScheduler(std::size_t width,
+                             std::size_t height,
+                             std::vector<Tile> const &regions)
+    : width(width) {
+    std::vector<std::pair<std::uint64_t, Tile>> ordered;
+    for (Tile const &region : regions) {
+        std::size_t x1 = std::min(region.x1, width);
+        std::size_t y1 = std::min(region.y1, height);
+        if (region.x0 >= x1 || region.y0 >= y1) {
+            continue;
+        }
+        for (std::size_t ty = region.y0 / TILE_SIZE; ty * TILE_SIZE < y1; ty++) {
+            for (std::size_t tx = region.x0 / TILE_SIZE; tx * TILE_SIZE < x1; tx++) {
+                Tile tile{std::max(tx * TILE_SIZE, region.x0),
+                          std::max(ty * TILE_SIZE, region.y0),
+                          std::min((tx + 1) * TILE_SIZE, x1),
+                          std::min((ty + 1) * TILE_SIZE, y1),
+                          0.0};
+                tile.cost = static_cast<double>((tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+                ordered.emplace_back(mortonCode(static_cast<std::uint32_t>(tx),
+                                                static_cast<std::uint32_t>(ty)),
+                                     tile);
+            }
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(), [](auto const &a, auto const &b) {
+        return a.first < b.first;
+    });
+    for (auto const &[code, tile] : ordered) {
+        tiles.push_back(tile);
+    }
+}
+
+void TileScheduler::estimateCosts(std::vector<double> const &iterCounts,
+                                  std::vector<double> const *estimate,
+                                  int maxIterations) {
+    double known = 0.0;
+    std::size_t knownCount = 0;
+    std::vector<std::size_t> unknownCount(tiles.size(), 0);
+
+#pragma omp parallel for schedule(dynamic) reduction(+ : known, knownCount)
+    for (std::size_t t = 0; t < tiles.size(); t++) {
+        Tile &tile = tiles[t];
+        tile.cost = 0.0;
+        for (std::size_t y = tile.y0; y < tile.y1; y++) {
+            for (std::size_t x = tile.x0; x < tile.x1; x++) {
+                std::size_t idx = y * width + x;
+                if (!std::isnan(iterCounts[idx])) {
+                    continue;
+                }
+                double n = estimate ? (*estimate)[idx] : std::nan("");
+                if (std::isnan(n)) {
+                    unknownCount[t]++;
+                    continue;
+                }
+                double cost = n < 0.0 ? maxIterations : n;
+                tile.cost += cost;
+                known += cost;
+                knownCount++;
+            }
+        }
+    }
+
+    // pixels the estimate does not cover cost what the covered ones do on average
+    double mean = knownCount ? known / knownCount : 1.0;
+    for (std::size_t t = 0; t < tiles.size(); t++) {
+        tiles[t].cost += mean * unknownCount[t];
+    }
+}
+
+void TileScheduler::run(std::function<void(Tile const &)> const &work) {
+    std::size_t workerCount = static_cast<std::size_t>(omp_get_max_threads());
+    std::vector<Worker> workers(workerCount);
+    distribute(workers);
+    busySeconds.resize(std::max(busySeconds.size(), workerCount), 0.0);
+
+    auto start = std::chrono::steady_clock::now();
+#pragma omp parallel num_threads(static_cast<int>(workerCount))
+    {
+        // a smaller team than asked for leaves shares without owner, they get stolen
+        std::size_t self = static_cast<std::size_t>(omp_get_thread_num());
+        PROFILE_SCOPE("tiles");
+        std::size_t tile;
+        while (take(workers, self, tile)) {
+            auto tileStart = std::chrono::steady_clock::now();
+            work(tiles[tile]);
+            workers[self].busySeconds += seconds(tileStart);
+        }
+    }
+    wallSeconds += seconds(start);
+    for (std::size_t w = 0; w < workerCount; w++) {
+        busySeconds[w] += workers[w].busySeconds;
+    }
+}
+
+std::vector<double> TileScheduler::utilization() const {
+    std::vector<double> result;
+    for (double busy : busySeconds) {
+        result.push_back(wallSeconds > 0.0 ? busy / wallSeconds : 0.0);
+    }
+    return result;
+}
+
+// contiguous Morton ranges of about equal cost, so each worker keeps to one area of the frame
+void TileScheduler::distribute(std::vector<Worker> &workers) const {
+    double total = 0.0;
+    for (Tile const &tile : tiles) {
+        total += tile.cost;
+    }
+    double share = total / workers.size();
+    double cumulative = 0.0;
+    for (std::size_t t = 0; t < tiles.size(); t++) {
+        if (tiles[t].cost <= 0.0) {
+            continue; // nothing left to compute
+        }
+        double middle = cumulative + 0.5 * tiles[t].cost;
+        std::size_t w = share > 0.0 ? static_cast<std::size_t>(middle / share) : 0;
+        workers[std::min(w, workers.size() - 1)].tiles.push_back(t);
+        cumulative += tiles[t].cost;
+    }
+    for (Worker &worker : workers) {
+        std::stable_sort(worker.tiles.begin(), worker.tiles.end(), [&](auto a, auto b) {
+            return tiles[a].cost > tiles[b].cost;
+        });
+    }
+}
+
+bool TileScheduler::take(std::vector<Worker> &workers, std::size_t self, std::size_t &tile) {
+    {
+        std::lock_guard<std::mutex> lock(workers[self].mutex);
+        if (!workers[self].tiles.empty()) {
+            tile = workers[self].tiles.front();
+            workers[self].tiles.pop_front();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < workers.size(); i++) {
+        Worker &victim = workers[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,93 @@
+#include "TileStore.hpp"
+
+#include "TileCache.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TileStore::TileStore(std::string const &directory,
+                     std::size_t samplesPerTile,
+                     std::size_t budgetBytes)
+    : path(directory + "/fractal-tiles-" + std::to_string(getpid()) + ".bin"),
+      recordBytes(sizeof(TileKey) + samplesPerTile * sizeof(double)),
+      budgetBytes(budgetBytes) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open tile store " + path);
+    }
+}
+
+TileStore::~TileStore() {
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+    }
+    close(fd);
+    unlink(path.c_str());
+}
+
+void TileStore::write(TileKey const &key, double const *samples) {
+    if (fileBytes + recordBytes > budgetBytes) {
+        reset();
+    }
+    std::vector<char> record(recordBytes);
+    std::memcpy(record.data(), &key, sizeof(TileKey));
+    std::memcpy(record.data() + sizeof(TileKey), samples, recordBytes - sizeof(TileKey));
+    if (pwrite(fd, record.data(), recordBytes, static_cast<off_t>(fileBytes)) !=
+        static_cast<ssize_t>(recordBytes)) {
+        return; // disk full or similar, the tile is just not cached
+    }
+    offsets[TileKeyHash{}(key)] = fileBytes;
+    fileBytes += recordBytes;
+}
+
+bool TileStore::read(TileKey const &key, double *samples) {
+    auto it = offsets.find(TileKeyHash{}(key));
+    if (it == offsets.end()) {
+        return false;
+    }
+    if (it->second + recordBytes > mappedBytes) {
+        remap();
+        if (!mapping) {
+            return false;
+        }
+    }
+    char const *record = static_cast<char const *>(mapping) + it->second;
+    if (std::memcmp(record, &key, sizeof(TileKey)) != 0) {
+        return false; // hash collision, the record belongs to another tile
+    }
+    std::memcpy(samples, record + sizeof(TileKey), recordBytes - sizeof(TileKey));
+    return true;
+}
+
+void TileStore::remap() {
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mappedBytes = 0;
+    }
+    if (fileBytes == 0) {
+        return;
+    }
+    void *newMapping = mmap(nullptr, fileBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (newMapping != MAP_FAILED) {
+        mapping = newMapping;
+        mappedBytes = fileBytes;
+    }
+}
+
+void TileStore::reset() {
+    if (mapping) {
+        munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mappedBytes = 0;
+    }
+    if (ftruncate(fd, 0) == 0) {
+        fileBytes = 0;
+    }
+    offsets.clear();
+}
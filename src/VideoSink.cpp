@@ -0,0 +1,105 @@
+#include "VideoSink.hpp"
+
+#include "PngStreamWriter.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+class PngSequenceSink : public VideoSink {
+public:
+    PngSequenceSink(std::string const &directory, unsigned width, unsigned height)
+        : directory(directory), width(width), height(height) {
+        std::filesystem::create_directories(directory);
+    }
+
+    void writeFrame(std::uint8_t const *rgba) override {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06u.png", frameIndex++);
+        PngStreamWriter writer((std::filesystem::path(directory) / name).string(), width, height);
+        writer.writeRows(rgba, height);
+        writer.finish();
+    }
+
+    void finish() override {}
+
+private:
+    std::string directory;
+    unsigned width, height;
+    unsigned frameIndex = 0;
+};
+
+/* 4:4:4 so no chroma is lost to subsampling, bt.601 studio range which encoders assume */
+class Y4mSink : public VideoSink {
+public:
+    Y4mSink(std::string const &filename, unsigned width, unsigned height, double fps)
+        : filename(filename), width(width), height(height) {
+        file = filename == "-" ? stdout : std::fopen(filename.c_str(), "wb");
+        if (!file) {
+            throw std::runtime_error("Cannot open " + filename);
+        }
+        std::size_t pixels = std::size_t(width) * height;
+        planes.resize(3 * pixels);
+        long rate = std::lround(fps * 1000.0);
+        std::fprintf(file, "YUV4MPEG2 W%u H%u F%ld:1000 Ip A1:1 C444\n", width, height, rate);
+        check();
+    }
+
+    ~Y4mSink() override {
+        if (file && file != stdout) {
+            std::fclose(file);
+        }
+    }
+
+    void writeFrame(std::uint8_t const *rgba) override {
+        std::size_t pixels = std::size_t(width) * height;
+        std::uint8_t *y = planes.data();
+        std::uint8_t *cb = y + pixels;
+        std::uint8_t *cr = cb + pixels;
+        for (std::size_t i = 0; i < pixels; i++) {
+            double r = rgba[4 * i], g = rgba[4 * i + 1], b = rgba[4 * i + 2];
+            y[i] = static_cast<std::uint8_t>(16.5 + 0.257 * r + 0.504 * g + 0.098 * b);
+            cb[i] = static_cast<std::uint8_t>(128.5 - 0.148 * r - 0.291 * g + 0.439 * b);
+            cr[i] = static_cast<std::uint8_t>(128.5 + 0.439 * r - 0.368 * g - 0.071 * b);
+        }
+        std::fputs("FRAME\n", file);
+        std::fwrite(planes.data(), 1, planes.size(), file);
+        check();
+    }
+
+    void finish() override {
+        std::fflush(file);
+        check();
+    }
+
+private:
+    void check() const {
+        if (std::ferror(file)) {
+            throw std::runtime_error("Cannot write " + filename);
+        }
+    }
+
+    std::string filename;
+    unsigned width, height;
+    std::FILE *file = nullptr;
+    std::vector<std::uint8_t> planes; // y, cb, cr one after the other
+};
+
+bool endsWith(std::string const &text, std::string const &suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+std::unique_ptr<VideoSink>
+VideoSink::open(std::string const &output, unsigned width, unsigned height, double fps) {
+    if (output == "-" || endsWith(output, ".y4m")) {
+        return std::make_unique<Y4mSink>(output, width, height, fps);
+    }
+    return std::make_unique<PngSequenceSink>(output, width, height);
+}
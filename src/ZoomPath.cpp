@@ -0,0 +1,91 @@
+#include "ZoomPath.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+ZoomPath::ZoomPath(std::vector<Keyframe> keyframes) : keyframes(std::move(keyframes)) {
+    if (this->keyframes.empty()) {
+        throw std::invalid_argument("Zoom path without keyframes");
+    }
+    for (std::size_t i = 1; i < this->keyframes.size(); i++) {
+        if (!(this->keyframes[i].time > this->keyframes[i - 1].time)) {
+            throw std::invalid_argument("Keyframe times must increase");
+        }
+    }
+}
+
+double ZoomPath::startTime() const {
+    return keyframes.front().time;
+}
+
+double ZoomPath::duration() const {
+    return keyframes.back().time - keyframes.front().time;
+}
+
+// index of the keyframe starting the segment the time falls in, clamped to the path
+std::size_t ZoomPath::segmentAt(double time) const {
+    if (keyframes.size() == 1) {
+        return 0;
+    }
+    auto next = std::upper_bound(keyframes.begin(),
+                                 keyframes.end(),
+                                 time,
+                                 [](double t, Keyframe const &key) { return t < key.time; });
+    std::size_t index = static_cast<std::size_t>(next - keyframes.begin());
+    return std::clamp<std::size_t>(index, 1, keyframes.size() - 1) - 1;
+}
+
+double ZoomPath::logZoomAt(double time) const {
+    if (keyframes.size() == 1) {
+        return keyframes[0].logZoom;
+    }
+    std::size_t i = segmentAt(time);
+    Keyframe const &a = keyframes[i];
+    Keyframe const &b = keyframes[i + 1];
+    double s = std::clamp((time - a.time) / (b.time - a.time), 0.0, 1.0);
+    return a.logZoom + s * (b.logZoom - a.logZoom);
+}
+
+Viewport ZoomPath::at(double time, double aspect) const {
+    double width = BASE_WIDTH * std::exp2(-logZoomAt(time));
+    if (keyframes.size() == 1) {
+        return {keyframes[0].centerX, keyframes[0].centerY, width, width * aspect};
+    }
+    std::size_t i = segmentAt(time);
+    Keyframe const &a = keyframes[i];
+    Keyframe const &b = keyframes[i + 1];
+    double widthA = BASE_WIDTH * std::exp2(-a.logZoom);
+    double widthB = BASE_WIDTH * std::exp2(-b.logZoom);
+    double s = std::clamp((time - a.time) / (b.time - a.time), 0.0, 1.0);
+    // the center moves as the width shrinks, linear in time it would race through deep frames
+    double f = widthA != widthB ? (widthA - width) / (widthA - widthB) : s;
+    return {a.centerX + f * (b.centerX - a.centerX),
+            a.centerY + f * (b.centerY - a.centerY),
+            width,
+            width * aspect};
+}
+
+bool ZoomPath::zoomIncreasing() const {
+    for (std::size_t i = 1; i < keyframes.size(); i++) {
+        if (!(keyframes[i].logZoom > keyframes[i - 1].logZoom)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// inverse of logZoomAt, clamped to the path
+double ZoomPath::timeAtLogZoom(double logZoom) const {
+    if (keyframes.size() == 1 || logZoom <= keyframes.front().logZoom) {
+        return keyframes.front().time;
+    }
+    for (std::size_t i = 0; i + 1 < keyframes.size(); i++) {
+        Keyframe const &a = keyframes[i];
+        Keyframe const &b = keyframes[i + 1];
+        if (logZoom <= b.logZoom) {
+            return a.time + (logZoom - a.logZoom) / (b.logZoom - a.logZoom) * (b.time - a.time);
+        }
+    }
+    return keyframes.back().time;
+}
@@ -0,0 +1,301 @@
+#include "ZoomVideo.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+/* runs jobs one after the other on its own thread, submit() blocks while depth jobs wait */
+class WriterThread {
+public:
+    explicit WriterThread(std::size_t depth) : depth(depth), worker([this] { loop(); }) {}
+
+    ~WriterThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    /* rethrows the exception of an earlier job that failed */
+    void submit(std::function<void()> job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return jobs.size() < depth || error; });
+        rethrow();
+        jobs.push_back(std::move(job));
+        cv.notify_all();
+    }
+
+    /* waits until every job ran */
+    void drain() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return (jobs.empty() && !busy) || error; });
+        rethrow();
+    }
+
+private:
+    void loop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return !jobs.empty() || stopping; });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy = true;
+            }
+            cv.notify_all();
+            std::exception_ptr failure;
+            try {
+                job();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy = false;
+                if (failure && !error) {
+                    error = failure;
+                    jobs.clear();
+                }
+            }
+            cv.notify_all();
+        }
+    }
+
+    void rethrow() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::size_t depth;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> jobs;
+    bool busy = false;
+    bool stopping = false;
+    std::exception_ptr error;
+    std::thread worker;
+};
+
+// bilinear, nearest where the four samples straddle the set: -1 has no iteration count to blend
+float sample(std::vector<float> const &field, unsigned width, unsigned height, double u, double v) {
+    u = std::clamp(u, 0.0, static_cast<double>(width - 1));
+    v = std::clamp(v, 0.0, static_cast<double>(height - 1));
+    unsigned x0 = static_cast<unsigned>(u), y0 = static_cast<unsigned>(v);
+    unsigned x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+    float fx = static_cast<float>(u - x0), fy = static_cast<float>(v - y0);
+    float a = field[std::size_t(y0) * width + x0], b = field[std::size_t(y0) * width + x1];
+    float c = field[std::size_t(y1) * width + x0], d = field[std::size_t(y1) * width + x1];
+    if (a < 0.0f || b < 0.0f || c < 0.0f || d < 0.0f) {
+        return fy < 0.5f ? (fx < 0.5f ? a : b) : (fx < 0.5f ? c : d);
+    }
+    float top = a + fx * (b - a);
+    float bottom = c + fx * (d - c);
+    return top + fy * (bottom - top);
+}
+
+} // namespace
+
+ZoomVideo::ZoomVideo(FractalBase &fractal,
+                     ZoomPath path,
+                     unsigned width,
+                     unsigned height,
+                     double fps)
+    : fractal(fractal), path(std::move(path)), width(width), height(height), fps(fps) {}
+
+std::size_t ZoomVideo::frameCount() const {
+    return static_cast<std::size_t>(std::floor(path.duration() * fps)) + 1;
+}
+
+double ZoomVideo::frameTime(std::size_t index) const {
+    return path.startTime() + static_cast<double>(index) / fps;
+}
+
+Viewport ZoomVideo::frameViewport(std::size_t index) const {
+    return path.at(frameTime(index), static_cast<double>(height) / width);
+}
+
+void ZoomVideo::render(Mode mode, VideoSink &sink, std::ostream &log) {
+    auto start = std::chrono::steady_clock::now();
+    if (mode == Mode::Octave) {
+        renderOctaves(sink, log);
+    } else {
+        renderExact(sink, log);
+    }
+    sink.finish();
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log << "\n" << frameCount() << " frames in " << seconds << " s, "
+        << frameCount() * 3600.0 / seconds << " frames/hour" << std::endl;
+}
+
+void ZoomVideo::renderExact(VideoSink &sink, std::ostream &log) {
+    sf::Image image({width, height});
+    Viewport vp;
+    WriterThread writer(PIPELINE_DEPTH);
+    std::size_t frames = frameCount();
+    for (std::size_t i = 0; i < frames; i++) {
+        // the fractal keeps the previous frame, whatever of it lines up is not iterated again
+        vp = frameViewport(i);
+        fractal.backupAndReplacePointers(&image, &vp);
+        fractal.compute();
+        fractal.restoreBackedUpPointers();
+        writer.submit([this, &sink, field = fractal.iterationField()] { writeField(sink, field); });
+        log << "\rFrame " << i + 1 << "/" << frames << std::flush;
+    }
+    writer.drain();
+}
+
+void ZoomVideo::renderOctaves(VideoSink &sink, std::ostream &log) {
+    if (!path.zoomIncreasing()) {
+        throw std::invalid_argument("Octave zoom videos need a path that keeps zooming in");
+    }
+    std::size_t frames = frameCount();
+    double aspect = static_cast<double>(height) / width;
+    double firstZoom = path.logZoomAt(frameTime(0));
+    double lastZoom = path.logZoomAt(frameTime(frames - 1));
+    // key k at firstZoom + k, the frames in between use keys k and k + 1
+    std::size_t keyCount = static_cast<std::size_t>(std::floor(lastZoom - firstZoom)) + 2;
+    auto keyOf = [&](std::size_t frame) {
+        double octave = std::floor(path.logZoomAt(frameTime(frame)) - firstZoom);
+        return std::min(static_cast<std::size_t>(std::max(octave, 0.0)), keyCount - 2);
+    };
+    std::vector<Viewport> keyCenters(keyCount);
+    for (std::size_t k = 0; k < keyCount; k++) {
+        keyCenters[k] = path.at(path.timeAtLogZoom(firstZoom + k), aspect);
+    }
+
+    // keys wide enough to hold every frame of their octave even when the center moves,
+    // the same size for all so consecutive keys line up for reuse
+    double margin = 1.0;
+    for (std::size_t i = 0; i < frames; i++) {
+        Viewport vp = frameViewport(i);
+        Viewport const &key = keyCenters[keyOf(i)];
+        double dx = std::abs(static_cast<double>(vp.centerX - key.centerX));
+        double dy = std::abs(static_cast<double>(vp.centerY - key.centerY));
+        margin = std::max({margin, (2.0 * dx + vp.width) / key.width,
+                           (2.0 * dy + vp.height) / key.height});
+    }
+    // twice the frame resolution so the last frame of an octave is not upsampled, plus a
+    // pixel on each side for interpolation, even so the next key's samples line up
+    auto keySize = [&](unsigned frameSize) {
+        return 2 * (static_cast<unsigned>(std::ceil(margin * frameSize)) + 1);
+    };
+    unsigned keyWidth = keySize(width), keyHeight = keySize(height);
+    log << "Octave mode: " << keyCount << " keys of " << keyWidth << "x" << keyHeight << std::endl;
+
+    WriterThread writer(PIPELINE_DEPTH);
+    std::shared_ptr<Key> outer;
+    std::size_t frame = 0;
+    for (std::size_t k = 0; k < keyCount; k++) {
+        Viewport keyVp = keyCenters[k];
+        double spacing = keyVp.width / (2.0 * width);
+        keyVp.width = spacing * keyWidth;
+        keyVp.height = spacing * keyHeight;
+        std::shared_ptr<Key> inner = computeKey(keyVp, keyWidth, keyHeight);
+        log << "\rKey " << k + 1 << "/" << keyCount << std::flush;
+        if (!outer) {
+            outer = inner;
+            continue;
+        }
+        // the frames of octave k - 1, resampled on the writer thread while key k + 1 computes
+        std::size_t end = frame;
+        while (end < frames && keyOf(end) == k - 1) {
+            end++;
+        }
+        writer.submit([this, &sink, outer, inner, begin = frame, end] {
+            for (std::size_t i = begin; i < end; i++) {
+                writeField(sink, resample(*outer, *inner, frameViewport(i)));
+            }
+        });
+        frame = end;
+        outer = inner;
+    }
+    writer.drain();
+}
+
+std::shared_ptr<ZoomVideo::Key>
+ZoomVideo::computeKey(Viewport const &vp, unsigned keyWidth, unsigned keyHeight) {
+    PROFILE_SCOPE("video key");
+    auto key = std::make_shared<Key>();
+    key->vp = vp;
+    key->width = keyWidth;
+    key->height = keyHeight;
+    key->spacing = vp.width / keyWidth;
+
+    sf::Image image({keyWidth, keyHeight});
+    Viewport computeVp = vp;
+    fractal.backupAndReplacePointers(&image, &computeVp);
+    fractal.compute();
+    fractal.restoreBackedUpPointers();
+    key->field = fractal.iterationField();
+    return key;
+}
+
+// frame pixels take the inner, sharper key where it covers them, the outer one elsewhere
+std::vector<float>
+ZoomVideo::resample(Key const &outer, Key const &inner, Viewport const &vp) const {
+    PROFILE_SCOPE("video resample");
+    std::vector<float> field(std::size_t(width) * height);
+    double spacing = vp.width / width;
+    // key pixel coordinates of the frame's pixel (0, 0)
+    auto origin = [&](Key const &key, double &u, double &v) {
+        u = (static_cast<double>(vp.centerX - key.vp.centerX) + 0.5 * (key.vp.width - vp.width)) /
+            key.spacing;
+        v = (static_cast<double>(key.vp.centerY - vp.centerY) +
+             0.5 * (key.vp.height - vp.height)) /
+            key.spacing;
+    };
+    double outerU, outerV, innerU, innerV;
+    origin(outer, outerU, outerV);
+    origin(inner, innerU, innerV);
+    double outerStep = spacing / outer.spacing, innerStep = spacing / inner.spacing;
+
+#pragma omp parallel for
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x++) {
+            double u = innerU + x * innerStep, v = innerV + y * innerStep;
+            bool covered = u >= 0.0 && v >= 0.0 && u <= inner.width - 1.0 && v <= inner.height - 1.0;
+            field[std::size_t(y) * width + x] =
+                covered ? sample(inner.field, inner.width, inner.height, u, v)
+                        : sample(outer.field,
+                                 outer.width,
+                                 outer.height,
+                                 outerU + x * outerStep,
+                                 outerV + y * outerStep);
+        }
+    }
+    return field;
+}
+
+void ZoomVideo::writeField(VideoSink &sink, std::vector<float> const &field) {
+    PROFILE_SCOPE("video write");
+    ColorRange range = Colorizer::range(field.data(), field.size());
+    if (!hasShownRange) {
+        shownRange = range;
+        hasShownRange = true;
+    } else {
+        shownRange.minIter += RANGE_SMOOTHING * (range.minIter - shownRange.minIter);
+        shownRange.maxIter += RANGE_SMOOTHING * (range.maxIter - shownRange.maxIter);
+    }
+    pixels.resize(field.size() * 4);
+    colorizer.apply(field.data(), field.size(), shownRange, pixels.data());
+    sink.writeFrame(pixels.data());
+}
@@ -0,0 +1,260 @@
+/* checks the vector kernels bit for bit against the scalar loop of EscapeTime.hpp on every
+ * instruction set the cpu runs, and the cycle proof against plain iteration. Exits 1 on the
+ * first group of mismatches, run by ctest */
+
+#include <EscapeTime.hpp>
+#include <SimdKernel.hpp>
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int MAX_ITERATIONS = 2000;
+// the limit the resumed points go on to
+constexpr int RAISED_ITERATIONS = 4 * MAX_ITERATIONS;
+// not a multiple of any lane count, so the last batch runs with idle lanes
+constexpr std::size_t POINT_COUNT = 4099;
+
+// plain iteration for the cycle proof: steps from z = 0 and the longest period looked for
+constexpr int PLAIN_ITERATIONS = 50000;
+constexpr int MAX_PERIOD = 32;
+constexpr std::size_t CYCLE_POINT_COUNT = 1000;
+
+struct Points {
+    std::vector<double> cr, ci;
+};
+
+// half over the whole set, half in a window on its boundary where orbits are long, cycles have
+// high periods and points stop at the limit. Fixed seed, every run checks the same points
+Points randomPoints(std::size_t count) {
+    Points points;
+    std::mt19937_64 random(20240613);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    // the cusp, the neck of the period 2 bulb, the tip of the antenna, the rabbit
+    double const special[][2] = {{0.25, 0.0}, {-0.75, 0.0}, {-2.0, 0.0}, {-0.122, 0.745}};
+    for (auto const &c : special) {
+        points.cr.push_back(c[0]);
+        points.ci.push_back(c[1]);
+    }
+    while (points.cr.size() < count) {
+        if (points.cr.size() % 2 == 0) {
+            points.cr.push_back(-2.1 + 2.8 * unit(random));
+            points.ci.push_back(-1.3 + 2.6 * unit(random));
+        } else {
+            points.cr.push_back(-0.7503 + 0.01 * unit(random));
+            points.ci.push_back(0.1077 + 0.01 * unit(random));
+        }
+    }
+    return points;
+}
+
+bool sameBits(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+
+bool sameState(EscapeState const &a, EscapeState const &b) {
+    return sameBits(a.zr, b.zr) && sameBits(a.zi, b.zi) && sameBits(a.zrOld, b.zrOld) &&
+           sameBits(a.ziOld, b.ziOld) && a.n == b.n && a.nextCheck == b.nextCheck &&
+           a.checkPeriod == b.checkPeriod && a.capped == b.capped && sameBits(a.dz2, b.dz2);
+}
+
+/* counts and prints the points whose value or state differs from the reference */
+std::size_t compare(std::string const &what,
+                    Points const &points,
+                    std::vector<double> const &values,
+                    std::vector<double> const &expected,
+                    std::vector<EscapeState> const *states = nullptr,
+                    std::vector<EscapeState> const *expectedStates = nullptr) {
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < values.size(); i++) {
+        bool same = sameBits(values[i], expected[i]) &&
+                    (!states || sameState((*states)[i], (*expectedStates)[i]));
+        if (!same && mismatches++ < 5) {
+            std::cerr << what << ": c = " << points.cr[i] << " + " << points.ci[i] << "i gave "
+                      << values[i] << ", the scalar loop " << expected[i] << std::endl;
+        }
+    }
+    if (mismatches > 0) {
+        std::cerr << what << ": " << mismatches << " of " << values.size() << " points differ"
+                  << std::endl;
+    }
+    return mismatches;
+}
+
+/* escapeTime<T> of every point from z = 0 at the limit, then on from there to the raised one */
+template <typename T> struct Reference {
+    std::vector<double> values, raisedValues;
+    std::vector<EscapeState> states;
+
+    explicit Reference(Points const &points) {
+        std::size_t count = points.cr.size();
+        values.resize(count);
+        raisedValues.resize(count);
+        states.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            T cr = static_cast<T>(points.cr[i]), ci = static_cast<T>(points.ci[i]);
+            values[i] = escapeTime(cr, ci, MAX_ITERATIONS, &states[i]);
+            raisedValues[i] = escapeTime(cr, ci, RAISED_ITERATIONS);
+        }
+    }
+};
+
+/* the kernel of one isa without states, with fresh ones, and resumed from them */
+template <typename T>
+std::size_t checkKernel(SimdKernel &kernel, Points const &points, Reference<T> const &expected) {
+    bool single = sizeof(T) == sizeof(float);
+    std::string name = std::string(SimdKernel::isaName(kernel.isa())) +
+                       (single ? " float" : " double");
+    auto run = [&](double *out, EscapeState *states) {
+        if (single) {
+            kernel.computePointsFloat(
+                points.cr.data(), points.ci.data(), points.cr.size(), out, states);
+        } else {
+            kernel.computePoints(points.cr.data(), points.ci.data(), points.cr.size(), out, states);
+        }
+    };
+    std::size_t count = points.cr.size();
+    std::vector<double> values(count);
+    std::vector<EscapeState> states(count);
+    std::size_t mismatches = 0;
+
+    kernel.setMaxIterations(MAX_ITERATIONS);
+    run(values.data(), nullptr);
+    mismatches += compare(name, points, values, expected.values);
+
+    run(values.data(), states.data());
+    mismatches += compare(name + " with states", points, values, expected.values, &states,
+                          &expected.states);
+
+    // the capped points go on, the others start over
+    kernel.setMaxIterations(RAISED_ITERATIONS);
+    for (EscapeState &state : states) {
+        if (!state.capped) {
+            state = EscapeState{};
+        }
+    }
+    run(values.data(), states.data());
+    mismatches += compare(name + " resumed", points, values, expected.raisedValues);
+    return mismatches;
+}
+
+/* above FLOAT_MAX_ITERATIONS the float variant hands over to the double one. Only points that
+ * escape below MAX_ITERATIONS, the others could take up to the whole limit */
+std::size_t checkFloatFallback(SimdKernel &kernel,
+                               Points const &points,
+                               Reference<double> const &expected) {
+    Points escaping;
+    std::vector<double> escapingExpected;
+    for (std::size_t i = 0; i < points.cr.size(); i++) {
+        if (expected.values[i] >= 0.0) {
+            escaping.cr.push_back(points.cr[i]);
+            escaping.ci.push_back(points.ci[i]);
+            escapingExpected.push_back(expected.values[i]);
+        }
+    }
+    std::vector<double> values(escaping.cr.size());
+    kernel.setMaxIterations(SimdKernel::FLOAT_MAX_ITERATIONS + 1);
+    kernel.computePointsFloat(
+        escaping.cr.data(), escaping.ci.data(), escaping.cr.size(), values.data());
+    return compare(std::string(SimdKernel::isaName(kernel.isa())) + " float past 2^24",
+                   escaping,
+                   values,
+                   escapingExpected);
+}
+
+/* attractingCycle<T> must never prove a point that plain iteration sees escape, nor a period
+ * the cycle it settles on does not divide, and must prove the cycle plain iteration settles
+ * on. Only for multipliers below maxMultiplier2 in squared modulus: closer to 1 Newton divides
+ * by about 1 - multiplier and float rounding keeps its steps above NEWTON_TOLERANCE */
+template <typename T>
+std::size_t checkAttractingCycle(Points const &points, double maxMultiplier2) {
+    std::string name = sizeof(T) == sizeof(float) ? "attractingCycle float"
+                                                  : "attractingCycle double";
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < CYCLE_POINT_COUNT; i++) {
+        // the point as T sees it, so plain iteration and the proof have the same c
+        T cr = static_cast<T>(points.cr[i]), ci = static_cast<T>(points.ci[i]);
+        std::complex<double> c(static_cast<double>(cr), static_cast<double>(ci));
+        std::complex<double> z = 0.0;
+        int n = 0;
+        while (n < PLAIN_ITERATIONS && std::norm(z) <= 4.0) {
+            z = z * z + c;
+            n++;
+        }
+        bool escaped = std::norm(z) > 4.0;
+
+        // the shortest period the orbit closed up with, and the multiplier of that cycle
+        int period = 0;
+        std::complex<double> multiplier = 1.0;
+        if (!escaped) {
+            std::complex<double> w = z;
+            for (int p = 1; p <= MAX_PERIOD && period == 0; p++) {
+                multiplier *= 2.0 * w;
+                w = w * w + c;
+                if (std::norm(w - z) < 1e-20) {
+                    period = p;
+                }
+            }
+        }
+        bool proofExpected = period > 0 && std::norm(multiplier) < maxMultiplier2;
+
+        T zr = escaped ? cr : static_cast<T>(z.real());
+        T zi = escaped ? ci : static_cast<T>(z.imag());
+        for (int p = 1; p <= MAX_PERIOD; p++) {
+            std::uint64_t cost = 0;
+            bool proven = attractingCycle(cr, ci, zr, zi, p, cost);
+            bool wrong = proven ? escaped || (period > 0 && p % period != 0)
+                                : proofExpected && p == period;
+            if (wrong && mismatches++ < 5) {
+                std::cerr << name << ": c = " << c << ", period " << p
+                          << (proven ? " proven" : " not proven") << ", plain iteration "
+                          << (escaped ? "escaped" : "settled on period " + std::to_string(period))
+                          << std::endl;
+            }
+        }
+    }
+    if (mismatches > 0) {
+        std::cerr << name << ": " << mismatches << " wrong results" << std::endl;
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main() {
+    Points points = randomPoints(POINT_COUNT);
+    Reference<double> expected(points);
+    Reference<float> expectedFloat(points);
+
+    std::size_t mismatches = 0;
+    SimdKernel kernel(MAX_ITERATIONS);
+    SimdKernel::Isa widest = SimdKernel::detectIsa();
+    for (SimdKernel::Isa isa : {SimdKernel::Isa::Scalar,
+                                SimdKernel::Isa::SSE2,
+                                SimdKernel::Isa::AVX2,
+                                SimdKernel::Isa::AVX512}) {
+        kernel.setIsa(isa);
+        if (isa > widest || kernel.isa() != isa) {
+            std::cout << SimdKernel::isaName(isa) << ": not supported here, skipped" << std::endl;
+            continue;
+        }
+        std::size_t isaMismatches = checkKernel(kernel, points, expected) +
+                                    checkKernel(kernel, points, expectedFloat) +
+                                    checkFloatFallback(kernel, points, expected);
+        std::cout << SimdKernel::isaName(isa) << ": "
+                  << (isaMismatches == 0 ? "bit-identical" : "MISMATCH") << std::endl;
+        mismatches += isaMismatches;
+    }
+
+    std::size_t cycleMismatches =
+        checkAttractingCycle<double>(points, 1.0) + checkAttractingCycle<float>(points, 0.25);
+    std::cout << "attractingCycle: " << (cycleMismatches == 0 ? "agrees" : "MISMATCH")
+              << " with plain iteration" << std::endl;
+    mismatches += cycleMismatches;
+    return mismatches == 0 ? 0 : 1;
+}
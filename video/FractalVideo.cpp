@@ -0,0 +1,83 @@
+/* headless zoom video along the keyframes of the Video section of a config file. Usage:
+ *   fractal_video [config.yaml] [--mode octave|exact] [--output zoom.y4m|-|directory]
+ * Progress goes to stderr so the video can go to stdout, e.g.
+ *   fractal_video config.yaml --output - | ffmpeg -i - zoom.mp4 */
+
+#include <ConfigLoader.hpp>
+#include <FractalFactory.hpp>
+#include <Profiler.hpp>
+#include <VideoSink.hpp>
+#include <ZoomPath.hpp>
+#include <ZoomVideo.hpp>
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+    std::string configPath = "config.yaml";
+    std::string mode;
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--mode" || arg == "--output") {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            (arg == "--mode" ? mode : output) = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            configPath = arg;
+        }
+    }
+
+    std::streambuf *coutBuffer = std::cout.rdbuf();
+    int status = 0;
+    try {
+        ConfigLoader config(configPath);
+        auto const &video = config.videoParams;
+        mode = mode.empty() ? video.mode : mode;
+        output = output.empty() ? video.output : output;
+        if (mode != "octave" && mode != "exact") {
+            std::cerr << "Unknown mode " << mode << ", octave or exact" << std::endl;
+            return 1;
+        }
+        // stdout carries the video, what the fractal prints goes to stderr
+        if (output == "-") {
+            std::cout.rdbuf(std::cerr.rdbuf());
+        }
+
+        std::vector<Keyframe> keyframes;
+        for (auto const &key : video.keyframes) {
+            keyframes.push_back({key.time, HPReal(key.centerX), HPReal(key.centerY), key.logZoom});
+        }
+        ZoomPath path(std::move(keyframes));
+
+        // frames are placed by their viewport, snapping to the cache lattice would shift them
+        ConfigLoader::FractalParams params = config.fractalParams;
+        params.tileCacheMB = 0;
+        sf::Image image({video.width, video.height});
+        Viewport viewport = path.at(path.startTime(), double(video.height) / video.width);
+        auto fractal = makeFractal(params, &image, &viewport);
+
+        auto sink = VideoSink::open(output, video.width, video.height, video.fps);
+        ZoomVideo zoom(*fractal, std::move(path), video.width, video.height, video.fps);
+        std::cerr << zoom.frameCount() << " frames of " << video.width << "x" << video.height
+                  << " to " << output << std::endl;
+        zoom.render(mode == "octave" ? ZoomVideo::Mode::Octave : ZoomVideo::Mode::Exact,
+                    *sink,
+                    std::cerr);
+        if (Profiler::enabled()) {
+            Profiler::report(std::cerr);
+        }
+    } catch (std::exception const &e) {
+        std::cerr << "\n" << e.what() << std::endl;
+        status = 1;
+    }
+    std::cout.rdbuf(coutBuffer);
+    return status;
+}